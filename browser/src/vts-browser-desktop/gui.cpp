@@ -871,6 +871,10 @@ public:
 
                 S("GPU memory:", ms.currentGpuMemUseKB / 1024, " MB");
                 S("RAM memory:", ms.currentRamMemUseKB / 1024, " MB");
+                S("RAM cache:", ms.currentRamCacheKB / 1024, " MB");
+                S("Throughput:", ms.downloadThroughputKBps, " KB/s");
+                S("Lod scale:", ms.downloadLodScale, "");
+                S("Meta nodes:", ms.metaNodesPerSecond, " /s");
                 S("Node meta updates:", cs.currentNodeMetaUpdates, "");
                 S("Node draw updates:", cs.currentNodeDrawsUpdates, "");
                 S("Preparing:", ms.resourcesPreparing, "");
@@ -885,6 +889,15 @@ public:
                     S("Cache read:", ms.resourcesQueueCacheRead, "");
                     S("Cache write:", ms.resourcesQueueCacheWrite, "");
                     S("Downloads:", ms.resourcesQueueDownload, "");
+                    {
+                        static const char *classes[MapStatistics::FetchClasses] = { "- meta:", "- mesh:", "- texture:", "- geodata:", "- config:" };
+                        for (uint32 i = 0; i < MapStatistics::FetchClasses; i++)
+                        {
+                            std::ostringstream ss;
+                            ss << ms.resourcesQueueDownloadPerClass[i] << " (" << ms.resourcesDownloadWaitMsPerClass[i] << " ms)";
+                            S(classes[i], ss.str(), "");
+                        }
+                    }
                     S("Decode:", ms.resourcesQueueDecode, "");
                     S("Gpu:", ms.resourcesQueueUpload, "");
 
@@ -900,6 +913,7 @@ public:
                     S("Active:", ms.resourcesActive, "");
                     S("Downloaded:", ms.resourcesDownloaded, "");
                     S("Disk loaded:", ms.resourcesDiskLoaded, "");
+                    S("RAM loaded:", ms.resourcesRamLoaded, "");
                     S("Decoded:", ms.resourcesDecoded, "");
                     S("Uploaded:", ms.resourcesUploaded, "");
                     S("Created:", ms.resourcesCreated, "");
@@ -909,6 +923,17 @@ public:
                     nk_tree_pop(&ctx);
                 }
 
+                if (nk_tree_push(&ctx, NK_TREE_TAB, "Hosts", NK_MINIMIZED))
+                {
+                    float ratio2[] = { width * 0.7f, width * 0.2f };
+                    nk_layout_row(&ctx, NK_STATIC, 16, 2, ratio2);
+
+                    for (const auto &it : ms.hostConnectionsWindows)
+                        S(it.first.c_str(), it.second, "");
+
+                    nk_tree_pop(&ctx);
+                }
+
                 nk_tree_pop(&ctx);
             }
 
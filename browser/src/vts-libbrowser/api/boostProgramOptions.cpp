@@ -113,6 +113,18 @@ void optionsConfigMapCreate(
         ->implicit_value(!opts->diskCache),
         "Use disk cache.")
 
+    ((section + "startupSnapshot").c_str(),
+        po::value<bool>(&opts->startupSnapshot)
+        ->implicit_value(!opts->startupSnapshot),
+        "Start the map from a snapshot in the disk cache "
+        "and revalidate it in background.")
+
+    ((section + "decodedTextureCache").c_str(),
+        po::value<bool>(&opts->decodedTextureCache)
+        ->implicit_value(!opts->decodedTextureCache),
+        "Store decoded textures in the disk cache "
+        "to skip image decoding on revisits.")
+
     FILE_OPTIONS;
 }
 
@@ -150,11 +162,99 @@ void optionsConfigMapRuntime(
         po::value<uint32>(&opts->fetchFirstRetryTimeOffset),
         "Delay in seconds for first resource download retry.")
 
+    ((section + "fetchBreakerFailures").c_str(),
+        po::value<uint32>(&opts->fetchBreakerFailures),
+        "Number of consecutive failed downloads from a host "
+        "after which the downloads from the host are suspended.")
+
+    ((section + "fetchBreakerOpenTime").c_str(),
+        po::value<uint32>(&opts->fetchBreakerOpenTime),
+        "Time in seconds for which downloads from a failing host "
+        "are suspended.")
+
+    ((section + "fetchShareMeta").c_str(),
+        po::value<uint32>(&opts->fetchShareMeta),
+        "Relative share of downloads for meta tiles and nav tiles.")
+
+    ((section + "fetchShareMesh").c_str(),
+        po::value<uint32>(&opts->fetchShareMesh),
+        "Relative share of downloads for meshes.")
+
+    ((section + "fetchShareTexture").c_str(),
+        po::value<uint32>(&opts->fetchShareTexture),
+        "Relative share of downloads for textures.")
+
+    ((section + "fetchShareGeodata").c_str(),
+        po::value<uint32>(&opts->fetchShareGeodata),
+        "Relative share of downloads for geodata.")
+
+    ((section + "fetchShareConfig").c_str(),
+        po::value<uint32>(&opts->fetchShareConfig),
+        "Relative share of downloads for configurations and other resources.")
+
+    ((section + "fetchBatchPattern").c_str(),
+        po::value<std::string>(&opts->fetchBatchPattern),
+        "Regular expression of urls that may be downloaded in batches, "
+        "the first capture group is the tile id.")
+
+    ((section + "fetchBatchMax").c_str(),
+        po::value<uint32>(&opts->fetchBatchMax),
+        "Maximum number of resources in single batch download.")
+
+    ((section + "hotSetSize").c_str(),
+        po::value<uint32>(&opts->hotSetSize),
+        "Number of most used resources remembered for startup warm-up.")
+
+    ((section + "ramCacheMemoryKB").c_str(),
+        po::value<uint32>(&opts->ramCacheMemoryKB),
+        "Memory (in KB) for raw content of recently decoded resources, "
+        "including those still in use.")
+
+    ((section + "fetchTimeBudget").c_str(),
+        po::value<uint32>(&opts->fetchTimeBudget),
+        "Estimated time (in ms) to download the queue "
+        "above which the surfaces are traversed with coarser detail, "
+        "0 to disable.")
+
+    ((section + "fetchLodScaleMax").c_str(),
+        po::value<double>(&opts->fetchLodScaleMax),
+        "Maximum scale of targetPixelRatioSurfaces "
+        "on constrained networks.")
+
+    ((section + "textureDecodeScaling").c_str(),
+        po::value<bool>(&opts->textureDecodeScaling)
+        ->implicit_value(!opts->textureDecodeScaling),
+        "Decode distant jpeg textures at reduced resolution.")
+
+    ((section + "textureMipmapsOnDecode").c_str(),
+        po::value<bool>(&opts->textureMipmapsOnDecode)
+        ->implicit_value(!opts->textureMipmapsOnDecode),
+        "Generate texture mipmaps on the decode thread.")
+
+    ((section + "meshCacheOptimization").c_str(),
+        po::value<bool>(&opts->meshCacheOptimization)
+        ->implicit_value(!opts->meshCacheOptimization),
+        "Reorder mesh triangles for the gpu vertex cache.")
+
+    ((section + "meshQuantization").c_str(),
+        po::value<bool>(&opts->meshQuantization)
+        ->implicit_value(!opts->meshQuantization),
+        "Store mesh positions as 16 bit integers.")
+
+    ((section + "textureCompression").c_str(),
+        po::value<uint32>(&opts->textureCompression),
+        "Compress surface textures: 0 = none, 1 = bc1/bc3, 2 = etc2.")
+
     ((section + "debugSaveCorruptedFiles").c_str(),
         po::value<bool>(&opts->debugSaveCorruptedFiles)
         ->implicit_value(!opts->debugSaveCorruptedFiles),
         "debugSaveCorruptedFiles")
 
+    ((section + "debugValidateMeshParser").c_str(),
+        po::value<bool>(&opts->debugValidateMeshParser)
+        ->implicit_value(!opts->debugValidateMeshParser),
+        "Compare the direct mesh parser with the vtslibs loader.")
+
     FILE_OPTIONS;
 }
 
@@ -277,11 +377,53 @@ void optionsConfigFetcherOptions(
         po::value<sint32>(&opts->pipelining),
         "HTTP pipelining mode.")
 
+    ((section + "streamPriorities").c_str(),
+        po::value<bool>(&opts->streamPriorities)
+        ->implicit_value(!opts->streamPriorities),
+        "Send download priorities to servers and dispatch "
+        "waiting downloads by priority.")
+
+    ((section + "adaptiveHostConnections").c_str(),
+        po::value<bool>(&opts->adaptiveHostConnections)
+        ->implicit_value(!opts->adaptiveHostConnections),
+        "Adapt number of concurrent downloads for each host.")
+
+    ((section + "compression").c_str(),
+        po::value<bool>(&opts->compression)
+        ->implicit_value(!opts->compression),
+        "Ask servers for compressed transfers.")
+
+    ((section + "preconnect").c_str(),
+        po::value<bool>(&opts->preconnect)
+        ->implicit_value(!opts->preconnect),
+        "Open connections to mapconfig hosts ahead of the downloads.")
+
     ((section + "extraFileLog").c_str(),
         po::value<bool>(&opts->extraFileLog)
         ->implicit_value(!opts->extraFileLog),
         "Produce separate log with downloads.")
 
+    ((section + "recordPath").c_str(),
+        po::value<std::string>(&opts->recordPath),
+        "Record all downloads into an archive at this path.")
+
+    ((section + "replayPath").c_str(),
+        po::value<std::string>(&opts->replayPath),
+        "Serve all downloads from an archive at this path.")
+
+    ((section + "replayLatency").c_str(),
+        po::value<uint32>(&opts->replayLatency),
+        "Latency of replayed downloads: "
+        "0 = none, 1 = as recorded, 2 = uniformly distributed.")
+
+    ((section + "replayLatencyMin").c_str(),
+        po::value<uint32>(&opts->replayLatencyMin),
+        "Minimum latency (in ms) for uniformly distributed replay latency.")
+
+    ((section + "replayLatencyMax").c_str(),
+        po::value<uint32>(&opts->replayLatencyMax),
+        "Maximum latency (in ms) for uniformly distributed replay latency.")
+
     FILE_OPTIONS;
 }
 
@@ -384,7 +384,7 @@ std::string Map::getResourceFreeLayerGeodata(const std::string &name) const
 {
     if (getResourceFreeLayerType(name) != FreeLayerType::MonolithicGeodata)
         return "";
-    auto r = impl->getActualGeoFeatures(name);
+    auto r = impl->getActualGeoFeaturesJson(name);
     if (r.second)
         return *r.second;
     return "";
@@ -396,13 +396,28 @@ void Map::setResourceFreeLayerGeodata(const std::string &name, const std::string
     {
         LOGTHROW(err4, std::logic_error) << "Map is not yet available.";
     }
-    auto &v = impl->mapconfig->getFreeInfo(name)->overrideGeodata;
+    FreeInfo *info = impl->mapconfig->getFreeInfo(name);
+    auto &v = info->overrideGeodata;
     if (!v || *v != value)
     {
+        info->overrideGeodataStore.reset();
         if (value.empty())
             v.reset();
         else
+        {
             v = std::make_shared<const std::string>(value);
+            try
+            {
+                info->overrideGeodataStore
+                    = std::make_shared<const GeodataFeatureStore>(
+                        stringToJson(value));
+            }
+            catch (const std::exception &e)
+            {
+                LOG(err3) << "Failed parsing geodata features for <"
+                    << name << ">, with error <" << e.what() << ">";
+            }
+        }
     }
     purgeViewCache();
 }
@@ -63,7 +63,10 @@ void MapCreateOptions::applyJson(const std::string &json)
     AJ(searchSrsFallback, asString);
     AJ(customSrs1, asString);
     AJ(customSrs2, asString);
+    AJ(startupSnapshotLod, asUInt);
     AJ(diskCache, asBool);
+    AJ(startupSnapshot, asBool);
+    AJ(decodedTextureCache, asBool);
     AJ(hashCachePaths, asBool);
     AJ(searchUrlFallbackOutsideEarth, asBool);
     AJ(browserOptionsSearchUrls, asBool);
@@ -79,7 +82,10 @@ std::string MapCreateOptions::toJson() const
     TJ(searchSrsFallback, asString);
     TJ(customSrs1, asString);
     TJ(customSrs2, asString);
+    TJ(startupSnapshotLod, asUInt);
     TJ(diskCache, asBool);
+    TJ(startupSnapshot, asBool);
+    TJ(decodedTextureCache, asBool);
     TJ(hashCachePaths, asBool);
     TJ(searchUrlFallbackOutsideEarth, asBool);
     TJ(browserOptionsSearchUrls, asBool);
@@ -108,12 +114,31 @@ void MapRuntimeOptions::applyJson(const std::string &json)
     AJ(maxFetchRedirections, asUInt);
     AJ(maxFetchRetries, asUInt);
     AJ(fetchFirstRetryTimeOffset, asUInt);
+    AJ(fetchBreakerFailures, asUInt);
+    AJ(fetchBreakerOpenTime, asUInt);
+    AJ(fetchShareMeta, asUInt);
+    AJ(fetchShareMesh, asUInt);
+    AJ(fetchShareTexture, asUInt);
+    AJ(fetchShareGeodata, asUInt);
+    AJ(fetchShareConfig, asUInt);
+    AJ(fetchBatchPattern, asString);
+    AJ(fetchBatchMax, asUInt);
+    AJ(hotSetSize, asUInt);
+    AJ(ramCacheMemoryKB, asUInt);
+    AJ(fetchTimeBudget, asUInt);
+    AJ(fetchLodScaleMax, asDouble);
+    AJ(textureDecodeScaling, asBool);
+    AJ(textureMipmapsOnDecode, asBool);
+    AJ(meshCacheOptimization, asBool);
+    AJ(meshQuantization, asBool);
+    AJ(textureCompression, asUInt);
     AJ(measurementUnitsSystem, asUInt);
     AJ(debugVirtualSurfaces, asBool);
     AJ(debugSaveCorruptedFiles, asBool);
     AJ(debugValidateGeodataStyles, asBool);
     AJ(debugCoarsenessDisks, asBool);
     AJ(debugExtractRawResources, asBool);
+    AJ(debugValidateMeshParser, asBool);
 }
 
 std::string MapRuntimeOptions::toJson() const
@@ -129,12 +154,31 @@ std::string MapRuntimeOptions::toJson() const
     TJ(maxFetchRedirections, asUInt);
     TJ(maxFetchRetries, asUInt);
     TJ(fetchFirstRetryTimeOffset, asUInt);
+    TJ(fetchBreakerFailures, asUInt);
+    TJ(fetchBreakerOpenTime, asUInt);
+    TJ(fetchShareMeta, asUInt);
+    TJ(fetchShareMesh, asUInt);
+    TJ(fetchShareTexture, asUInt);
+    TJ(fetchShareGeodata, asUInt);
+    TJ(fetchShareConfig, asUInt);
+    TJ(fetchBatchPattern, asString);
+    TJ(fetchBatchMax, asUInt);
+    TJ(hotSetSize, asUInt);
+    TJ(ramCacheMemoryKB, asUInt);
+    TJ(fetchTimeBudget, asUInt);
+    TJ(fetchLodScaleMax, asDouble);
+    TJ(textureDecodeScaling, asBool);
+    TJ(textureMipmapsOnDecode, asBool);
+    TJ(meshCacheOptimization, asBool);
+    TJ(meshQuantization, asBool);
+    TJ(textureCompression, asUInt);
     TJ(measurementUnitsSystem, asUInt);
     TJ(debugVirtualSurfaces, asBool);
     TJ(debugSaveCorruptedFiles, asBool);
     TJ(debugValidateGeodataStyles, asBool);
     TJ(debugCoarsenessDisks, asBool);
     TJ(debugExtractRawResources, asBool);
+    TJ(debugValidateMeshParser, asBool);
     return jsonToString(v);
 }
 
@@ -315,6 +359,15 @@ void FetcherOptions::applyJson(const std::string &json)
     AJ(maxTotalConnections, asUInt);
     AJ(maxCacheConections, asUInt);
     AJ(pipelining, asUInt);
+    AJ(streamPriorities, asBool);
+    AJ(adaptiveHostConnections, asBool);
+    AJ(compression, asBool);
+    AJ(preconnect, asBool);
+    AJ(recordPath, asString);
+    AJ(replayPath, asString);
+    AJ(replayLatency, asUInt);
+    AJ(replayLatencyMin, asUInt);
+    AJ(replayLatencyMax, asUInt);
 }
 
 std::string FetcherOptions::toJson() const
@@ -327,6 +380,15 @@ std::string FetcherOptions::toJson() const
     TJ(maxTotalConnections, asUInt);
     TJ(maxCacheConections, asUInt);
     TJ(pipelining, asUInt);
+    TJ(streamPriorities, asBool);
+    TJ(adaptiveHostConnections, asBool);
+    TJ(compression, asBool);
+    TJ(preconnect, asBool);
+    TJ(recordPath, asString);
+    TJ(replayPath, asString);
+    TJ(replayLatency, asUInt);
+    TJ(replayLatencyMin, asUInt);
+    TJ(replayLatencyMax, asUInt);
     return jsonToString(v);
 }
 
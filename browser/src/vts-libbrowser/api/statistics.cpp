@@ -37,6 +37,7 @@ std::string MapStatistics::toJson() const
     TJ(resourcesCreated, asUint);
     TJ(resourcesDownloaded, asUint);
     TJ(resourcesDiskLoaded, asUint);
+    TJ(resourcesRamLoaded, asUint);
     TJ(resourcesDecoded, asUint);
     TJ(resourcesUploaded, asUint);
     TJ(resourcesFailed, asUint);
@@ -52,9 +53,21 @@ std::string MapStatistics::toJson() const
     TJ(resourcesQueueUpload, asUint);
     TJ(resourcesQueueAtmosphere, asUint);
     TJ(resourcesAccessed, asUint);
+    for (auto it : resourcesQueueDownloadPerClass)
+        v["resourcesQueueDownloadPerClass"].append(it);
+    for (auto it : resourcesDownloadWaitMsPerClass)
+        v["resourcesDownloadWaitMsPerClass"].append(it);
     TJ(currentGpuMemUseKB, asUint);
     TJ(currentRamMemUseKB, asUint);
+    TJ(currentRamCacheKB, asUint);
+    TJ(downloadThroughputKBps, asUint);
+    TJ(downloadLodScale, asDouble);
+    TJ(metaNodesGenerated, asUint);
+    TJ(metaNodesPerSecond, asUint);
     TJ(renderTicks, asUint);
+    for (const auto &it : hostConnectionsWindows)
+        v["hostConnectionsWindows"][it.first] = it.second;
+    TJ(timeToFirstFrameMs, asUint);
     return jsonToString(v);
 }
 
@@ -42,6 +42,7 @@ public:
     FetchTask::ResourceType resourceType() const override;
     void checkTime();
     void authorize(const std::shared_ptr<Resource> &);
+    void authorize(const std::string &name, FetchTask::Query &query);
 
 private:
     std::string token;
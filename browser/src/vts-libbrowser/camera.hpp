@@ -128,6 +128,9 @@ public:
     bool visibilityTest(TraverseNode *trav);
     bool coarsenessTest(TraverseNode *trav);
     double coarsenessValue(TraverseNode *trav);
+    double texelScreenSize(const vec3 &point, double texelSize);
+    uint32 textureDecodeScale(TraverseNode *trav);
+    static uint32 textureDecodeScale(uint32 scale, float uvScale);
     float getTextSize(float size, const std::string &text);
     void renderText(TraverseNode *trav, float x, float y, const vec4f &color, float size, const std::string &text, bool centerText = true);
     void renderNodeBox(TraverseNode *trav, const vec4f &color);
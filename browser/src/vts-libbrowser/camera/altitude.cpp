@@ -289,11 +289,11 @@ bool CameraImpl::getSurfaceOverEllipsoid(
         auto t = findTravSds(this, travRoot, points[i], desiredLod);
         if (!t)
             return false;
-        if (!t->meta->surrogateNav)
+        if (!t->meta->surrogateNav())
             return false;
         const math::Extents2 &ext = t->meta->extents;
         points[i] = vecFromUblas<vec2>(ext.ll + ext.ur) * 0.5;
-        altitudes[i] = *t->meta->surrogateNav;
+        altitudes[i] = *t->meta->surrogateNav();
         nodes[i] = t;
     }
 
@@ -315,7 +315,7 @@ bool CameraImpl::getSurfaceOverEllipsoid(
             {
                 const TraverseNode *t = nodes[i];
                 double scale = t->meta->extents.size() * 0.035;
-                task.model = translationMatrix(*t->meta->surrogatePhys)
+                task.model = translationMatrix(*t->meta->surrogatePhys())
                         * scaleMatrix(scale);
                 draws.infographics.push_back(convert(task));
                 scaleSum += scale;
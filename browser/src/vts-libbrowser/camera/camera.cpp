@@ -36,6 +36,7 @@
 #include "../coordsManip.hpp"
 #include "../hashTileId.hpp"
 #include "../geodata.hpp"
+#include "../resources.hpp"
 
 #include <unordered_set>
 #include <optick.h>
@@ -139,12 +140,13 @@ bool CameraImpl::visibilityTest(TraverseNode *trav)
 {
     assert(trav->meta);
     // aabb test
-    if (!aabbTest(trav->meta->aabbPhys, cullingPlanes))
+    const vec3 aabb[2] = { trav->meta->aabbPhys(0), trav->meta->aabbPhys(1) };
+    if (!aabbTest(aabb, cullingPlanes))
         return false;
     // additional obb test
-    if (trav->meta->obb)
+    MetaNode::Obb obb;
+    if (trav->meta->obb(obb))
     {
-        const MetaNode::Obb &obb = *trav->meta->obb;
         vec4 planes[6];
         vts::frustumPlanes(viewProjCulling * obb.rotInv, planes);
         if (!aabbTest(obb.points, planes))
@@ -154,13 +156,48 @@ bool CameraImpl::visibilityTest(TraverseNode *trav)
     return true;
 }
 
+uint32 CameraImpl::textureDecodeScale(TraverseNode *trav)
+{
+    if (!map->options.textureDecodeScaling || trav->layer->isGeodata())
+        return 1;
+    const auto &meta = trav->meta;
+    if (!(meta->texelSize() > 0) || std::isinf(meta->texelSize()))
+        return 1;
+
+    // the traversal stops at the nodes whose nearest corner
+    //   is just below the target ratio,
+    //   the texture is sized by the ratio at the middle of the node
+    //   which is representative for most of its texels
+    const vec3 center = (meta->aabbPhys(0) + meta->aabbPhys(1)) * 0.5;
+    const double c = texelScreenSize(center, meta->texelSize());
+    if (!(c > 0) || std::isinf(c))
+        return 1;
+    const double t = options.targetPixelRatioSurfaces
+        * map->resources->downloadLodScale;
+    uint32 s = 1;
+    while (s < 8 && c * s * 2 <= t)
+        s *= 2;
+    return s;
+}
+
+uint32 CameraImpl::textureDecodeScale(uint32 scale, float uvScale)
+{
+    // texture shared by multiple finer tiles has proportionally coarser texels
+    while (scale > 1 && uvScale < 0.75f)
+    {
+        scale /= 2;
+        uvScale *= 2;
+    }
+    return scale;
+}
+
 bool CameraImpl::coarsenessTest(TraverseNode *trav)
 {
     assert(trav->meta);
     return coarsenessValue(trav)
         < (trav->layer->isGeodata()
         ? options.targetPixelRatioGeodata
-        : options.targetPixelRatioSurfaces);
+        : options.targetPixelRatioSurfaces * map->resources->downloadLodScale);
 }
 
 namespace
@@ -186,21 +223,21 @@ double distanceToDisk(const vec3 &diskNormal,
 double CameraImpl::coarsenessValue(TraverseNode *trav)
 {
     assert(trav->meta);
-    assert(!std::isnan(trav->meta->texelSize));
+    assert(!std::isnan(trav->meta->texelSize()));
 
     const auto &meta = trav->meta;
 
-    if (meta->texelSize == inf1())
-        return meta->texelSize;
+    if (meta->texelSize() == inf1())
+        return meta->texelSize();
 
     if (map->options.debugCoarsenessDisks
-        && !std::isnan(meta->diskHalfAngle))
+        && !std::isnan(meta->diskHalfAngle()))
     {
         // test the value at point at the distance from the disk
-        double dist = distanceToDisk(meta->diskNormalPhys,
-            meta->diskHeightsPhys, meta->diskHalfAngle,
+        double dist = distanceToDisk(meta->diskNormalPhys(),
+            meta->diskHeightsPhys(), meta->diskHalfAngle(),
             cameraPosPhys);
-        double v = meta->texelSize * diskNominalDistance / dist;
+        double v = meta->texelSize() * diskNominalDistance / dist;
         assert(!std::isnan(v) && v > 0);
         return v;
     }
@@ -208,22 +245,23 @@ double CameraImpl::coarsenessValue(TraverseNode *trav)
     {
         // test the value on all corners of node bounding box
         double result = 0;
-        for (uint32 i = 0; i < 8; i++)
-        {
-            vec3 c = meta->cornersPhys(i);
-            vec3 up = perpendicularUnitVector * meta->texelSize;
-            vec3 c1 = c - up * 0.5;
-            vec3 c2 = c1 + up;
-            c1 = vec4to3(vec4(viewProjRender * vec3to4(c1, 1)), true);
-            c2 = vec4to3(vec4(viewProjRender * vec3to4(c2, 1)), true);
-            double len = std::abs(c2[1] - c1[1]);
-            result = std::max(result, len);
-        }
-        result *= windowHeight * 0.5;
+        for (const vec3 &c : meta->cornersPhys())
+            result = std::max(result, texelScreenSize(c, meta->texelSize()));
         return result;
     }
 }
 
+double CameraImpl::texelScreenSize(const vec3 &point, double texelSize)
+{
+    // size of the texel in pixels on the screen
+    vec3 up = perpendicularUnitVector * texelSize;
+    vec3 c1 = point - up * 0.5;
+    vec3 c2 = c1 + up;
+    c1 = vec4to3(vec4(viewProjRender * vec3to4(c1, 1)), true);
+    c2 = vec4to3(vec4(viewProjRender * vec3to4(c2, 1)), true);
+    return std::abs(c2[1] - c1[1]) * windowHeight * 0.5;
+}
+
 float CameraImpl::getTextSize(float size, const std::string &text)
 {
     float x = 0;
@@ -273,7 +311,7 @@ void CameraImpl::renderText(TraverseNode *trav, float x, float y,
         map->getTexture("internal://data/textures/debugFont2.png");
     task.textureColor->priority = inf1();
 
-    task.model = translationMatrix(*trav->meta->surrogatePhys);
+    task.model = translationMatrix(*trav->meta->surrogatePhys());
     task.color = color;
 
     if (centerText)
@@ -360,14 +398,16 @@ void CameraImpl::renderNodeBox(TraverseNode *trav, const vec4f &color)
         return translationMatrix((box[0] + box[1]) * 0.5)
             * scaleMatrix((box[1] - box[0]) * 0.5);
     };
-    if (trav->meta->obb)
+    MetaNode::Obb obb;
+    if (trav->meta->obb(obb))
     {
-        task.model = trav->meta->obb->rotInv
-            * aabbMatrix(trav->meta->obb->points);
+        task.model = obb.rotInv
+            * aabbMatrix(obb.points);
     }
     else
     {
-        task.model = aabbMatrix(trav->meta->aabbPhys);
+        const vec3 aabb[2] = { trav->meta->aabbPhys(0), trav->meta->aabbPhys(1) };
+        task.model = aabbMatrix(aabb);
     }
 
     task.color = color;
@@ -399,6 +439,17 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
 
     bool isSubNode = trav != orig;
 
+    // texture resolution
+    {
+        const uint32 scale = textureDecodeScale(trav);
+        for (const auto &it : trav->opaque)
+            if (it.textureColor)
+                it.textureColor->requestScale(textureDecodeScale(scale, it.uvTrans[0]));
+        for (const auto &it : trav->transparent)
+            if (it.textureColor)
+                it.textureColor->requestScale(textureDecodeScale(scale, it.uvTrans[0]));
+    }
+
     // surfaces
     if (options.lodBlending)
         currentDraws.emplace_back(trav, orig);
@@ -415,14 +466,14 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
     }
 
     // surrogate
-    if (options.debugRenderSurrogates && trav->meta->surrogatePhys)
+    if (options.debugRenderSurrogates && trav->meta->surrogatePhys())
     {
         RenderInfographicsTask task;
         task.mesh = map->getMesh("internal://data/meshes/sphere.obj");
         task.mesh->priority = inf1();
         if (task.ready())
         {
-            task.model = translationMatrix(*trav->meta->surrogatePhys)
+            task.model = translationMatrix(*trav->meta->surrogatePhys())
                 * scaleMatrix(trav->meta->extents.size() * 0.03);
             task.color = vec3to4(trav->surface->color, task.color(3));
             draws.infographics.emplace_back(convert(task));
@@ -507,7 +558,7 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
         if (options.debugRenderTileTexelSize)
         {
             sprintf(stmp, "%.2f %.2f",
-                trav->meta->texelSize, coarsenessValue(trav));
+                trav->meta->texelSize(), coarsenessValue(trav));
             renderText(trav, 0, (size + 2), vec4f(1, 0, 1, 1), size, stmp);
         }
 
@@ -959,6 +1010,14 @@ void CameraImpl::renderUpdate()
     }
     sortOpaqueFrontToBack();
 
+    // time to first frame
+    if (map->statistics.timeToFirstFrameMs == 0 && !draws.opaque.empty())
+    {
+        map->statistics.timeToFirstFrameMs = std::max<uint32>(1,
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - map->mapconfigPathTime).count());
+    }
+
     // update camera credits
     map->credits->tick(credits);
 }
@@ -42,7 +42,7 @@ double CameraImpl::travDistance(TraverseNode *trav, const vec3 pointPhys)
 {
     // checking the distance in node srs may be more accurate,
     //   but the resulting distance is in different units
-    return aabbPointDist(pointPhys, trav->meta->aabbPhys[0], trav->meta->aabbPhys[1]);
+    return aabbPointDist(pointPhys, trav->meta->aabbPhys(0), trav->meta->aabbPhys(1));
 }
 
 void CameraImpl::updateNodePriority(TraverseNode *trav)
@@ -60,7 +60,10 @@ std::shared_ptr<GpuTexture> CameraImpl::travInternalTexture(TraverseNode *trav,
     UrlTemplate::Vars vars(trav->id, trav->meta->localId, subMeshIndex);
     std::shared_ptr<GpuTexture> res = map->getTexture(trav->surface->urlIntTex(vars));
     map->touchResource(res);
+    res->requestScale(textureDecodeScale(trav));
     res->updatePriority(trav->priority);
+    if (trav->id.lod <= map->createOptions.startupSnapshotLod)
+        res->snapshotTile = true;
     return res;
 }
 
@@ -111,6 +114,8 @@ bool CameraImpl::travDetermineMeta(TraverseNode *trav)
                     continue;
             }
             trav->metaTiles[i] = map->getMetaTile(trav->layer->surfaceStack.surfaces[i].urlMeta(tileIdVars));
+            if (nodeId.lod <= map->createOptions.startupSnapshotLod)
+                trav->metaTiles[i]->snapshotTile = true;
         }
     }
 
@@ -166,6 +171,11 @@ bool CameraImpl::travDetermineMeta(TraverseNode *trav)
     if (!chosen)
         return false; // all surfaces failed to download, what can i do?
 
+    // meta node
+    std::shared_ptr<const MetaNode> node = chosen->getNode(nodeId);
+    if (!node)
+        return false; // the metatile has failed
+
     // surface
     if (topmost)
     {
@@ -175,8 +185,7 @@ bool CameraImpl::travDetermineMeta(TraverseNode *trav)
             trav->credits.push_back(it);
     }
 
-    // meta node
-    trav->meta = chosen->getNode(nodeId);
+    trav->meta = std::move(node);
 
     // prepare children
     if (childsAvailable[0] || childsAvailable[1] || childsAvailable[2] || childsAvailable[3])
@@ -234,6 +243,8 @@ bool CameraImpl::travDetermineDrawsSurface(TraverseNode *trav)
     {
         const std::string name = trav->surface->urlMesh(UrlTemplate::Vars(nodeId, trav->meta->localId));
         meshAgg = map->getMeshAggregate(name);
+        if (nodeId.lod <= map->createOptions.startupSnapshotLod)
+            meshAgg->snapshotTile = true;
         trav->resources.push_back(meshAgg);
     }
     meshAgg->updatePriority(trav->priority);
@@ -267,12 +278,16 @@ bool CameraImpl::travDetermineDrawsSurface(TraverseNode *trav)
                 bls.push_back(BoundParamInfo(vtslibs::registry::View::BoundLayerParams(map->mapconfig->boundLayers.get(part.textureLayer).id)));
             const Validity validity = reorderBoundLayers(trav->id, trav->meta->localId, subMeshIndex, bls, trav->priority);
 
+            const uint32 scale = textureDecodeScale(trav);
             for (const BoundParamInfo &it : bls)
             {
                 if (it.boundMetaTile)
                     trav->resources.push_back(it.boundMetaTile);
                 if (it.textureColor)
+                {
+                    it.textureColor->requestScale(textureDecodeScale(scale, it.uvTrans()[0]));
                     trav->resources.push_back(it.textureColor);
+                }
                 if (it.textureMask)
                     trav->resources.push_back(it.textureMask);
             }
@@ -412,7 +427,8 @@ bool CameraImpl::travDetermineDrawsGeodata(TraverseNode *trav)
 
     std::shared_ptr<GeodataTile> geo = map->getGeodata(geoName + "#tile");
     geo->updatePriority(trav->priority);
-    geo->update(style.second, features.second, map->mapconfig->browserOptions.value, trav->meta->aabbPhys, trav->id);
+    const vec3 aabb[2] = { trav->meta->aabbPhys(0), trav->meta->aabbPhys(1) };
+    geo->update(style.second, features.second, map->mapconfig->browserOptions.value, aabb, trav->id);
     switch (map->getResourceValidity(geo))
     {
     case Validity::Invalid:
@@ -59,6 +59,9 @@ public:
     vec3 convert(const vec3 &value, const std::string &from, Srs to);
     vec3 convert(const vec3 &value, Srs from, const std::string &to);
 
+    // convert count points at once, in and out may be the same array
+    void convert(const vec3 *in, vec3 *out, uint32 count, const std::string &from, Srs to);
+
     vec3 geoDirect(const vec3 &position, double distance, double azimuthIn, double &azimuthOut);
     vec3 geoDirect(const vec3 &position, double distance, double azimuthIn);
     void geoInverse(const vec3 &posA, const vec3 &posB, double &distance, double &azimuthA, double &azimuthB);
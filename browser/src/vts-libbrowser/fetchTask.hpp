@@ -29,6 +29,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "include/vts-browser/fetcher.hpp"
 
@@ -43,6 +44,7 @@ class FetchTaskImpl : public FetchTask
 public:
     FetchTaskImpl(const std::shared_ptr<Resource> &resource);
     void fetchDone() override;
+    float priority() const override;
 
     bool performAvailTest() const;
 
@@ -51,6 +53,43 @@ public:
     std::shared_ptr<void> availTest; // vtslibs::registry::BoundLayer::Availability
     std::weak_ptr<Resource> resource;
     uint32 redirectionsCount = 0;
+    bool batchable = true;
+
+    // the url split by the batch pattern, cached by the fetcher thread
+    std::string batchPrefix, batchSuffix, batchId;
+    uint32 batchPatternVersion = 0;
+    bool batchMatched = false;
+};
+
+// fetches multiple resources in single request to a batch endpoint
+//   and splits the multipart reply back into the individual tasks
+class BatchFetchTask : public FetchTask
+{
+public:
+    BatchFetchTask(MapImpl *map, const std::string &url,
+        const std::string &key,
+        std::vector<std::shared_ptr<FetchTaskImpl>> &&members,
+        std::vector<std::string> &&ids);
+    void fetchDone() override;
+    float priority() const override;
+
+    MapImpl *const map = nullptr;
+    const std::string key;
+    const std::vector<std::shared_ptr<FetchTaskImpl>> members;
+    const std::vector<std::string> ids;
+};
+
+// fetches a resource that was loaded from the startup snapshot
+//   and compares it with the content of the snapshot
+class SnapshotRevalidateTask : public FetchTask
+{
+public:
+    SnapshotRevalidateTask(const std::shared_ptr<Resource> &resource);
+    void fetchDone() override;
+
+    const std::string name;
+    MapImpl *const map = nullptr;
+    const std::string snapshotHash;
 };
 
 } // namespace vts
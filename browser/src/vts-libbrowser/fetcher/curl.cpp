@@ -25,8 +25,14 @@
  */
 
 #include "../include/vts-browser/fetcher.hpp"
+#include "../utilities/url.hpp"
 
+#include <cmath>
 #include <fstream>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <zlib.h>
 #include <http/http.hpp>
 #include <http/resourcefetcher.hpp>
 
@@ -38,19 +44,123 @@ namespace
 
 class FetcherImpl;
 
+// libhttp does not expose the response headers,
+//   therefore the content encoding is recognized from the data:
+//   full gzip member header (magic, deflate method, no reserved flags)
+//   on a reply that is not declared to be a gzip file itself
+bool isGzipEncoded(const std::string &data, const std::string &contentType)
+{
+    if (contentType.find("gzip") != std::string::npos)
+        return false;
+    return data.size() >= 18 && (unsigned char)data[0] == 0x1f
+        && (unsigned char)data[1] == 0x8b && data[2] == 8
+        && ((unsigned char)data[3] & 0xe0) == 0;
+}
+
+// images are compressed already, their transfer is not
+bool requestGzip(FetchTask::ResourceType type)
+{
+    switch (type)
+    {
+    case FetchTask::ResourceType::Texture:
+    case FetchTask::ResourceType::Font:
+        return false;
+    default:
+        return true;
+    }
+}
+
+// decompress directly into the reply buffer, growing it as needed
+void gunzip(const std::string &in, Buffer &out)
+{
+    z_stream s;
+    memset(&s, 0, sizeof(s));
+    if (inflateInit2(&s, 16 + MAX_WBITS) != Z_OK)
+    {
+        LOGTHROW(err2, std::runtime_error)
+            << "Failed to initialize gzip decompression";
+    }
+    s.next_in = (Bytef*)in.data();
+    s.avail_in = in.size();
+    out.allocate(std::max<uint32>(in.size() * 4, 4096));
+    uint32 used = 0;
+    int ret = Z_OK;
+    while (ret != Z_STREAM_END)
+    {
+        if (used == out.size())
+            out.resize(out.size() * 2);
+        s.next_out = (Bytef*)out.data() + used;
+        s.avail_out = out.size() - used;
+        ret = inflate(&s, Z_NO_FLUSH);
+        used = out.size() - s.avail_out;
+        if (ret != Z_OK && ret != Z_STREAM_END)
+        {
+            inflateEnd(&s);
+            LOGTHROW(err2, std::runtime_error)
+                << "Failed gzip decompression, code " << ret;
+        }
+    }
+    inflateEnd(&s);
+    out.resize(used);
+}
+
+class PreconnectTask : public FetchTask
+{
+public:
+    PreconnectTask(const std::string &url)
+        : FetchTask(url, FetchTask::ResourceType::Undefined)
+    {
+        // the content is irrelevant
+        query.headers["Range"] = "bytes=0-0";
+    }
+
+    void fetchDone() override
+    {
+        LOG(debug) << "Preconnected to <" << query.url << ">, http code "
+                   << reply.code;
+    }
+};
+
+// maps priority of a download to http urgency (RFC 9218)
+//   0 is the most urgent, 7 the least
+// required resources have infinite priority,
+//   traversal priorities decrease with distance from the camera
+uint32 urgency(float priority)
+{
+    if (std::isinf(priority) && priority > 0)
+        return 0;
+    if (!(priority > 0))
+        return 7;
+    const float l = std::log10(priority + 1);
+    return 7 - std::max(1, std::min(6, (int)l));
+}
+
+struct HostState
+{
+    double window = 6;
+    double latency = 0; // smoothed, in ms
+    double baseLatency = 0; // latency of unloaded host, in ms
+    uint64 lastDecrease = 0;
+    uint32 active = 0;
+    std::deque<std::shared_ptr<FetchTask>> waiting;
+};
+
 class Task
 {
 public:
-    Task(FetcherImpl *impl, const std::shared_ptr<FetchTask> &task);
+    Task(FetcherImpl *impl, const std::shared_ptr<FetchTask> &task,
+        bool counted);
     ~Task();
     void done(http::ResourceFetcher::MultiQuery &&queries);
     void finish();
 
     const uint64 begin;
     FetcherImpl *const impl;
+    const std::string host;
     const uint32 id;
     http::ResourceFetcher::Query query;
     std::shared_ptr<FetchTask> task;
+    const bool counted; // included in the host connections window
     bool called;
 };
 
@@ -101,7 +211,127 @@ public:
     {
         assert(initCount > 0);
         assert(task->reply.code == 0);
-        auto t = std::make_shared<Task>(this, task);
+        if (options.adaptiveHostConnections)
+        {
+            std::lock_guard<std::mutex> lock(hostsMut);
+            HostState &h = hosts[extractUrlHost(task->query.url)];
+            if (h.active >= (uint32)h.window)
+            {
+                h.waiting.push_back(task);
+                return;
+            }
+            h.active++;
+        }
+        perform(task);
+    }
+
+    void preconnect(const std::string &origin) override
+    {
+        // a tiny request opens the connection (dns, tcp and tls)
+        //   which stays in the connection cache for the following downloads
+        //   it is excluded from the host connections window
+        //   and its reply does not reach the resources (nor the circuit breaker)
+        assert(initCount > 0);
+        if (!options.preconnect)
+            return;
+        perform(std::make_shared<PreconnectTask>(origin + "/"), false);
+    }
+
+    sint32 updateTimeout() override
+    {
+        // the waiting downloads are dispatched
+        //   only after other downloads finish
+        return -1;
+    }
+
+    void update() override
+    {
+        if (!options.adaptiveHostConnections)
+            return;
+        std::vector<std::shared_ptr<FetchTask>> ready;
+        {
+            std::lock_guard<std::mutex> lock(hostsMut);
+            for (auto &it : hosts)
+            {
+                HostState &h = it.second;
+                while (!h.waiting.empty() && h.active < (uint32)h.window)
+                {
+                    auto w = h.waiting.begin();
+                    if (options.streamPriorities)
+                    {
+                        // priorities may have changed while waiting
+                        float best = -1;
+                        for (auto i = h.waiting.begin();
+                             i != h.waiting.end(); i++)
+                        {
+                            float p = (*i)->priority();
+                            if (p > best)
+                            {
+                                best = p;
+                                w = i;
+                            }
+                        }
+                    }
+                    ready.push_back(std::move(*w));
+                    h.waiting.erase(w);
+                    h.active++;
+                }
+            }
+        }
+        for (const auto &t : ready)
+            perform(t);
+    }
+
+    std::map<std::string, uint32> hostConnectionsWindows() override
+    {
+        std::map<std::string, uint32> res;
+        std::lock_guard<std::mutex> lock(hostsMut);
+        for (const auto &it : hosts)
+            res[it.first] = (uint32)it.second.window;
+        return res;
+    }
+
+    void hostDone(const std::string &host, uint32 code, uint64 latency)
+    {
+        if (!options.adaptiveHostConnections)
+            return;
+        std::lock_guard<std::mutex> lock(hostsMut);
+        HostState &h = hosts[host];
+        assert(h.active > 0);
+        h.active--;
+        bool congested = code == FetchTask::ExtraCodes::Timeout
+            || code == 429 || code == 503;
+        if (code == 200)
+        {
+            h.latency = h.latency == 0 ? latency
+                : h.latency * 0.8 + latency * 0.2;
+            // the base slowly follows the latency up
+            //   so that permanently slower host is not penalized forever
+            h.baseLatency = h.baseLatency == 0 ? latency
+                : std::min<double>(latency, h.baseLatency * 1.01 + 1);
+            if (h.latency > h.baseLatency * 3 + 100)
+                congested = true;
+        }
+        const double maxWindow = options.maxHostConnections
+            ? options.maxHostConnections * options.threads : 64;
+        if (congested)
+        {
+            // decrease at most once per round trip
+            const uint64 now = time();
+            if (now > h.lastDecrease + (uint64)h.latency)
+            {
+                h.window = std::max(1.0, h.window * 0.5);
+                h.lastDecrease = now;
+            }
+        }
+        else if (code < 400)
+            h.window = std::min(maxWindow, h.window + 1 / h.window);
+    }
+
+    void perform(const std::shared_ptr<FetchTask> &task,
+        bool counted = true)
+    {
+        auto t = std::make_shared<Task>(this, task, counted);
         fetcher.perform(t->query, std::bind(&Task::done, t,
                                             std::placeholders::_1));
         if (extraLog)
@@ -125,15 +355,29 @@ public:
     std::atomic<uint32> taskId;
     std::ofstream extraLog;
     std::chrono::high_resolution_clock::time_point begin;
+    std::unordered_map<std::string, HostState> hosts;
+    std::mutex hostsMut;
 };
 
-Task::Task(FetcherImpl *impl, const std::shared_ptr<FetchTask> &task)
-    : begin(impl->time()), impl(impl), id(impl->taskId++),
-      query(task->query.url), task(task), called(false)
+Task::Task(FetcherImpl *impl, const std::shared_ptr<FetchTask> &task,
+    bool counted)
+    : begin(impl->time()), impl(impl), host(extractUrlHost(task->query.url)),
+      id(impl->taskId++),
+      query(task->query.url), task(task), counted(counted), called(false)
 {
     query.timeout(impl->options.timeout);
     for (auto it : task->query.headers)
         query.addOption(it.first, it.second);
+    if (impl->options.compression
+        && requestGzip(task->query.resourceType)
+        && task->query.headers.count("Accept-Encoding") == 0)
+        query.addOption("Accept-Encoding", "gzip");
+    if (impl->options.streamPriorities
+        && task->query.headers.count("Priority") == 0)
+    {
+        query.addOption("Priority", std::string("u=")
+                        + std::to_string(urgency(task->priority())));
+    }
 }
 
 Task::~Task()
@@ -164,9 +408,30 @@ void Task::done(utility::ResourceFetcher::MultiQuery &&queries)
         }
         else
         {
-            task->reply.content.allocate(body.data.size());
-            memcpy(task->reply.content.data(), body.data.data(),
-                   body.data.size());
+            bool inflated = false;
+            if (impl->options.compression
+                && requestGzip(task->query.resourceType)
+                && isGzipEncoded(body.data, body.contentType))
+            {
+                try
+                {
+                    gunzip(body.data, task->reply.content);
+                    inflated = true;
+                }
+                catch (std::exception &e)
+                {
+                    // binary content that merely resembles gzip
+                    LOG(warn2) << "Content of <" << task->query.url
+                              << "> is kept as received, <"
+                              << e.what() << ">";
+                }
+            }
+            if (!inflated)
+            {
+                task->reply.content.allocate(body.data.size());
+                memcpy(task->reply.content.data(), body.data.data(),
+                       body.data.size());
+            }
             task->reply.contentType = body.contentType;
             task->reply.expires = body.expires;
             task->reply.code = 200;
@@ -225,6 +490,8 @@ void Task::finish()
             << " " << task->reply.code << " " << task->reply.content.size()
             << " " << task->reply.contentType << std::endl;
     }
+    if (counted)
+        impl->hostDone(host, task->reply.code, impl->time() - begin);
     task->fetchDone();
 }
 
@@ -232,8 +499,13 @@ void Task::finish()
 
 std::shared_ptr<Fetcher> Fetcher::create(const FetcherOptions &options)
 {
-    return std::dynamic_pointer_cast<Fetcher>(
+    if (!options.replayPath.empty())
+        return createReplay(options);
+    auto f = std::dynamic_pointer_cast<Fetcher>(
                 std::make_shared<FetcherImpl>(options));
+    if (!options.recordPath.empty())
+        return createRecorder(options, f);
+    return f;
 }
 
 } // namespace vts
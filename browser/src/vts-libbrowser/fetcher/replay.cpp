@@ -0,0 +1,411 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../include/vts-browser/fetcher.hpp"
+
+#include <dbglog/dbglog.hpp>
+
+#include <cstring>
+#include <cassert>
+#include <fstream>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <chrono>
+#include <unordered_map>
+
+namespace vts
+{
+
+namespace
+{
+
+static const char ArchiveMagic[] = "vtsfetch";
+static const uint32 ArchiveVersion = 1;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Record
+{
+    FetchTask::Query query;
+    FetchTask::Reply reply;
+    uint32 latency = 0; // ms
+
+    Record() : query("", FetchTask::ResourceType::Undefined)
+    {}
+};
+
+void writeValue(std::ostream &out, uint32 v)
+{
+    out.write((const char *)&v, sizeof(v));
+}
+
+void writeValue(std::ostream &out, sint64 v)
+{
+    out.write((const char *)&v, sizeof(v));
+}
+
+void writeValue(std::ostream &out, const std::string &v)
+{
+    writeValue(out, (uint32)v.size());
+    out.write(v.data(), v.size());
+}
+
+void writeValue(std::ostream &out, const Buffer &v)
+{
+    writeValue(out, v.size());
+    out.write(v.data(), v.size());
+}
+
+template<class T>
+void readValue(std::istream &in, T &v)
+{
+    in.read((char *)&v, sizeof(v));
+}
+
+void readValue(std::istream &in, std::string &v)
+{
+    uint32 s = 0;
+    readValue(in, s);
+    if (!in)
+        return;
+    v.resize(s);
+    in.read(&v[0], s);
+}
+
+void readValue(std::istream &in, Buffer &v)
+{
+    uint32 s = 0;
+    readValue(in, s);
+    if (!in)
+        return;
+    v.allocate(s);
+    in.read(v.data(), s);
+}
+
+class Archive
+{
+public:
+    Archive(const std::string &path)
+    {
+        out.open(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            LOGTHROW(err3, std::runtime_error)
+                << "Failed to open fetch archive <" << path << ">";
+        }
+        out.write(ArchiveMagic, sizeof(ArchiveMagic));
+        writeValue(out, ArchiveVersion);
+        LOG(info3) << "Recording downloads into <" << path << ">";
+    }
+
+    void write(const FetchTask::Query &query,
+        const FetchTask::Reply &reply, uint32 latency)
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        writeValue(out, query.url);
+        writeValue(out, (uint32)query.headers.size());
+        for (const auto &it : query.headers)
+        {
+            writeValue(out, it.first);
+            writeValue(out, it.second);
+        }
+        writeValue(out, (uint32)query.resourceType);
+        writeValue(out, reply.code);
+        writeValue(out, reply.contentType);
+        writeValue(out, reply.redirectUrl);
+        writeValue(out, reply.expires);
+        writeValue(out, latency);
+        writeValue(out, reply.content);
+        out.flush(); // keep the archive usable even if the application crashes
+    }
+
+private:
+    std::mutex mut;
+    std::ofstream out;
+};
+
+class RecordTask : public FetchTask
+{
+public:
+    RecordTask(const std::shared_ptr<Archive> &archive,
+        const std::shared_ptr<FetchTask> &task) :
+        FetchTask(task->query), archive(archive), task(task),
+        begin(Clock::now())
+    {}
+
+    void fetchDone() override
+    {
+        uint32 latency = std::chrono::duration_cast<
+            std::chrono::milliseconds>(Clock::now() - begin).count();
+        archive->write(query, reply, latency);
+        task->reply = std::move(reply);
+        task->fetchDone();
+    }
+
+    float priority() const override
+    {
+        return task->priority();
+    }
+
+    const std::shared_ptr<Archive> archive;
+    const std::shared_ptr<FetchTask> task;
+    const Clock::time_point begin;
+};
+
+class RecordFetcherImpl : public Fetcher
+{
+public:
+    RecordFetcherImpl(const FetcherOptions &options,
+        const std::shared_ptr<Fetcher> &fetcher) :
+        archive(std::make_shared<Archive>(options.recordPath)),
+        fetcher(fetcher)
+    {}
+
+    void initialize() override
+    {
+        fetcher->initialize();
+    }
+
+    void finalize() override
+    {
+        fetcher->finalize();
+    }
+
+    void update() override
+    {
+        fetcher->update();
+    }
+
+    void fetch(const std::shared_ptr<FetchTask> &task) override
+    {
+        fetcher->fetch(std::make_shared<RecordTask>(archive, task));
+    }
+
+    void preconnect(const std::string &origin) override
+    {
+        fetcher->preconnect(origin);
+    }
+
+    sint32 updateTimeout() override
+    {
+        return fetcher->updateTimeout();
+    }
+
+    std::map<std::string, uint32> hostConnectionsWindows() override
+    {
+        return fetcher->hostConnectionsWindows();
+    }
+
+    const std::shared_ptr<Archive> archive;
+    const std::shared_ptr<Fetcher> fetcher;
+};
+
+class ReplayFetcherImpl : public Fetcher
+{
+public:
+    struct Pending
+    {
+        Clock::time_point due;
+        uint64 order;
+        std::shared_ptr<FetchTask> task;
+        const Record *record;
+
+        bool operator < (const Pending &other) const
+        {
+            // the priority queue returns the largest element first
+            if (due != other.due)
+                return due > other.due;
+            return order > other.order;
+        }
+    };
+
+    ReplayFetcherImpl(const FetcherOptions &options) :
+        options(options), random(0), order(0)
+    {
+        if (options.replayLatency > 2)
+        {
+            LOGTHROW(err3, std::invalid_argument)
+                << "Invalid replay latency model";
+        }
+        std::ifstream in(options.replayPath, std::ios::binary);
+        char magic[sizeof(ArchiveMagic)];
+        uint32 version = 0;
+        in.read(magic, sizeof(magic));
+        readValue(in, version);
+        if (!in || memcmp(magic, ArchiveMagic, sizeof(magic)) != 0
+            || version != ArchiveVersion)
+        {
+            LOGTHROW(err3, std::runtime_error)
+                << "Invalid fetch archive <" << options.replayPath << ">";
+        }
+        uint32 count = 0;
+        while (in.peek() != std::char_traits<char>::eof())
+        {
+            Record r;
+            readValue(in, r.query.url);
+            uint32 headers = 0;
+            readValue(in, headers);
+            for (uint32 i = 0; in && i < headers; i++)
+            {
+                std::string k, v;
+                readValue(in, k);
+                readValue(in, v);
+                r.query.headers[k] = v;
+            }
+            uint32 type = 0;
+            readValue(in, type);
+            r.query.resourceType = (FetchTask::ResourceType)type;
+            readValue(in, r.reply.code);
+            readValue(in, r.reply.contentType);
+            readValue(in, r.reply.redirectUrl);
+            readValue(in, r.reply.expires);
+            readValue(in, r.latency);
+            readValue(in, r.reply.content);
+            if (!in)
+            {
+                LOG(warn3) << "Fetch archive <" << options.replayPath
+                    << "> is truncated";
+                break;
+            }
+            records[r.query.url].push_back(std::move(r));
+            count++;
+        }
+        LOG(info3) << "Replaying " << count << " downloads from <"
+            << options.replayPath << ">";
+    }
+
+    void fetch(const std::shared_ptr<FetchTask> &task) override
+    {
+        assert(task->reply.code == 0);
+        std::lock_guard<std::mutex> lock(mut);
+        Pending p;
+        p.order = order++;
+        p.task = task;
+        p.record = nullptr;
+        auto it = records.find(task->query.url);
+        if (it != records.end())
+        {
+            // repeated downloads of same url are served in recorded order
+            uint32 &next = served[task->query.url];
+            p.record = &it->second[next++ % it->second.size()];
+        }
+        else
+        {
+            LOG(warn2) << "Download <" << task->query.url
+                << "> is not in the replay archive";
+        }
+        p.due = Clock::now() + std::chrono::milliseconds(latency(p.record));
+        pending.push(std::move(p));
+    }
+
+    void update() override
+    {
+        std::vector<Pending> ready;
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            const auto now = Clock::now();
+            while (!pending.empty() && pending.top().due <= now)
+            {
+                ready.push_back(pending.top());
+                pending.pop();
+            }
+        }
+        for (Pending &p : ready)
+        {
+            FetchTask::Reply &reply = p.task->reply;
+            if (p.record)
+            {
+                reply.content = p.record->reply.content.copy();
+                reply.contentType = p.record->reply.contentType;
+                reply.redirectUrl = p.record->reply.redirectUrl;
+                reply.expires = p.record->reply.expires;
+                reply.code = p.record->reply.code;
+            }
+            else
+                reply.code = 404;
+            p.task->fetchDone();
+        }
+    }
+
+    sint32 updateTimeout() override
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        if (pending.empty())
+            return -1;
+        auto d = std::chrono::duration_cast<std::chrono::milliseconds>(
+            pending.top().due - Clock::now()).count();
+        return std::max<sint32>(d, 0);
+    }
+
+    uint32 latency(const Record *record)
+    {
+        switch (options.replayLatency)
+        {
+        case 0:
+            return 0;
+        case 1:
+            return record ? record->latency : 0;
+        case 2:
+        {
+            // fixed seed makes the runs reproducible
+            std::uniform_int_distribution<uint32> dist(
+                options.replayLatencyMin,
+                std::max(options.replayLatencyMin,
+                    options.replayLatencyMax));
+            return dist(random);
+        }
+        default:
+            return 0;
+        }
+    }
+
+    const FetcherOptions options;
+    std::unordered_map<std::string, std::vector<Record>> records;
+    std::unordered_map<std::string, uint32> served;
+    std::priority_queue<Pending> pending;
+    std::mutex mut;
+    std::mt19937 random;
+    uint64 order;
+};
+
+} // namespace
+
+std::shared_ptr<Fetcher> Fetcher::createRecorder(
+    const FetcherOptions &options,
+    const std::shared_ptr<Fetcher> &fetcher)
+{
+    return std::dynamic_pointer_cast<Fetcher>(
+        std::make_shared<RecordFetcherImpl>(options, fetcher));
+}
+
+std::shared_ptr<Fetcher> Fetcher::createReplay(const FetcherOptions &options)
+{
+    return std::dynamic_pointer_cast<Fetcher>(
+        std::make_shared<ReplayFetcherImpl>(options));
+}
+
+} // namespace vts
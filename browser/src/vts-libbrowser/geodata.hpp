@@ -48,6 +48,96 @@ class GpuFont;
 class GpuTexture;
 class GpuGeodataSpec;
 
+// geodata features decoded once into flat tables
+//   shared by all geodata tiles that use the features
+class GeodataFeatureStore
+{
+public:
+    enum class Type
+    {
+        Point,
+        Line,
+        Polygon,
+    };
+
+    enum class ValueType : uint8
+    {
+        Null,
+        Bool,
+        Int,
+        UInt,
+        Real,
+        String,
+        Json, // arrays and objects, kept serialized
+    };
+
+    struct Value
+    {
+        ValueType type = ValueType::Null;
+        uint32 index = 0; // into ints, reals or strings, the value for bools
+    };
+
+    struct Range
+    {
+        uint32 begin = 0, end = 0;
+        uint32 size() const { return end - begin; }
+    };
+
+    struct Property
+    {
+        uint32 key; // into keys
+        Value value;
+    };
+
+    struct Feature
+    {
+        Value id;
+        Range properties; // into properties
+        // into arrays:
+        //   points: one array with all the points
+        //   lines: one array per line
+        //   polygons: the middle point followed by the vertices
+        Range arrays;
+        Range surface; // into indices, polygons only
+    };
+
+    struct Group
+    {
+        Value id;
+        vec3 bbox[2];
+        double resolution;
+        Range features[3]; // into features, for each type
+    };
+
+    explicit GeodataFeatureStore(const Json::Value &features);
+
+    Json::Value value(const Value &v) const;
+    Json::Value property(const Feature &f, const std::string &key) const;
+    const vec3f *coordinates(const Range &array) const
+    {
+        return points.data() + array.begin;
+    }
+    uint32 memoryUsage() const;
+
+    std::vector<Group> groups;
+    std::vector<Feature> features;
+    std::vector<Property> properties;
+    std::vector<Range> arrays; // into points
+    std::vector<vec3f> points; // raw coordinates, as in the source
+    std::vector<uint32> indices;
+    std::vector<std::string> keys;
+    std::vector<std::string> strings;
+    std::vector<sint64> ints;
+    std::vector<double> reals;
+    sint32 version = 0;
+
+private:
+    Feature storeFeature(const Json::Value &jf, Type type);
+    Value store(const Json::Value &v);
+    Range storeArray(const Json::Value &v);
+    std::map<std::string, uint32> keyIndices;
+};
+
 class GeodataFeatures : public Resource
 {
 public:
@@ -55,7 +145,11 @@ public:
     void decode() override;
     FetchTask::ResourceType resourceType() const override;
 
+    // the original json is kept only for monolithic layers,
+    //   whose json may be requested by the application
     std::shared_ptr<const std::string> data;
+    std::shared_ptr<const GeodataFeatureStore> store;
+    std::atomic<bool> keepJson{false};
 };
 
 class GeodataStylesheet : public Resource
@@ -85,14 +179,14 @@ public:
     FetchTask::ResourceType resourceType() const override;
     void update(
         const std::shared_ptr<GeodataStylesheet> &style,
-        const std::shared_ptr<const std::string> &features,
+        const std::shared_ptr<const GeodataFeatureStore> &features,
         const std::shared_ptr<const Json::Value> &browserOptions,
         const vec3 aabbPhys[2], const TileId &tileId);
 
     std::vector<ResourceInfo> renders;
     std::vector<GpuGeodataSpec> specsToUpload;
     std::shared_ptr<GeodataStylesheet> style;
-    std::shared_ptr<const std::string> features;
+    std::shared_ptr<const GeodataFeatureStore> features;
     std::shared_ptr<const Json::Value> browserOptions;
     vec3 aabbPhys[2];
     TileId tileId;
@@ -45,6 +45,7 @@ class GpuMesh : public Resource
 public:
     GpuMesh(MapImpl *map, const std::string &name);
     GpuMesh(MapImpl *map, const std::string &name, const vtslibs::vts::SubMesh &m);
+    GpuMesh(MapImpl *map, const std::string &name, GpuMeshSpec &&spec);
     void decode() override;
     void upload() override;
     bool requiresUpload() override { return true; }
@@ -59,10 +60,20 @@ public:
     void decode() override;
     void upload() override;
     bool requiresUpload() override { return true; }
+    bool readDecodedCache() override;
     FetchTask::ResourceType resourceType() const override;
     GpuTextureSpec::FilterMode filterMode = GpuTextureSpec::FilterMode::Linear;
     GpuTextureSpec::WrapMode wrapMode = GpuTextureSpec::WrapMode::ClampToEdge;
     uint32 width = 0, height = 0;
+
+    // jpeg textures may be decoded at reduced resolution (1 / scale)
+    // the traversal requests the scale every frame
+    //   and the texture is upgraded in place when it needs more detail
+    void requestScale(uint32 scale);
+    std::atomic<uint32> requestedScale {1};
+    uint32 requestedTick = (uint32)-1;
+    uint32 decodedScale = 1;
+    std::atomic<bool> surfaceTexture {false};
 };
 
 class GpuAtmosphereDensityTexture : public GpuTexture
@@ -70,6 +81,7 @@ class GpuAtmosphereDensityTexture : public GpuTexture
 public:
     GpuAtmosphereDensityTexture(MapImpl *map, const std::string &name);
     void decode() override;
+    bool readDecodedCache() override { return false; }
 };
 
 class GpuFont : public Resource
@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image.hpp"
+
+#include <avif/avif.h>
+#include <dbglog/dbglog.hpp>
+#include <algorithm>
+
+namespace vts
+{
+
+namespace
+{
+
+struct AvifDecoder
+{
+    avifDecoder *d;
+    AvifDecoder() : d(avifDecoderCreate())
+    {
+        if (!d)
+            LOGTHROW(err1, std::runtime_error)
+                << "failed to create avif decoder";
+    }
+    ~AvifDecoder()
+    {
+        avifDecoderDestroy(d);
+    }
+};
+
+void avifCheck(avifResult r)
+{
+    if (r != AVIF_RESULT_OK)
+        LOGTHROW(err1, std::runtime_error)
+            << "failed to decode avif image <" << avifResultToString(r) << ">";
+}
+
+} // namespace
+
+void decodeAvif(const Buffer &in, Buffer &out,
+                uint32 &width, uint32 &height, uint32 &components,
+                bool flip)
+{
+    AvifDecoder dec;
+    avifCheck(avifDecoderSetIOMemory(dec.d,
+        (const uint8_t*)in.data(), in.size()));
+    avifCheck(avifDecoderParse(dec.d));
+    avifCheck(avifDecoderNextImage(dec.d));
+    avifImage *img = dec.d->image;
+    width = img->width;
+    height = img->height;
+    components = img->alphaPlane ? 4 : 3;
+    out = Buffer(width * height * components);
+    avifRGBImage rgb;
+    avifRGBImageSetDefaults(&rgb, img);
+    rgb.format = components == 4 ? AVIF_RGB_FORMAT_RGBA : AVIF_RGB_FORMAT_RGB;
+    rgb.depth = 8;
+    rgb.pixels = (uint8_t*)out.data();
+    rgb.rowBytes = width * components;
+    avifCheck(avifImageYUVToRGB(img, &rgb));
+    if (flip)
+    {
+        // the conversion has no bottom-up output
+        const uint32 lineSize = width * components;
+        unsigned char *d = (unsigned char*)out.data();
+        for (uint32 y = 0; y < height / 2; y++)
+            std::swap_ranges(d + y * lineSize, d + (y + 1) * lineSize,
+                d + (height - y - 1) * lineSize);
+    }
+}
+
+} // namespace vts
@@ -0,0 +1,513 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace vts
+{
+
+namespace
+{
+
+typedef int Pixels[16][4]; // rgba, row major
+
+void fetchBlock(const unsigned char *in, uint32 width, uint32 height,
+    uint32 components, uint32 bx, uint32 by, Pixels &px)
+{
+    for (uint32 y = 0; y < 4; y++)
+    {
+        // pixels outside the image replicate the edge
+        const uint32 sy = std::min(by * 4 + y, height - 1);
+        for (uint32 x = 0; x < 4; x++)
+        {
+            const uint32 sx = std::min(bx * 4 + x, width - 1);
+            const unsigned char *s = in + (sy * width + sx) * components;
+            int *d = px[y * 4 + x];
+            d[0] = s[0];
+            d[1] = s[1];
+            d[2] = s[2];
+            d[3] = components == 4 ? s[3] : 255;
+        }
+    }
+}
+
+int clamp255(int v)
+{
+    return std::max(0, std::min(255, v));
+}
+
+int sqr(int v)
+{
+    return v * v;
+}
+
+////////////////////////////
+// BC1 & BC3
+////////////////////////////
+
+uint16 to565(const double c[3])
+{
+    const int r = clamp255((int)(c[0] + 0.5));
+    const int g = clamp255((int)(c[1] + 0.5));
+    const int b = clamp255((int)(c[2] + 0.5));
+    return (uint16)((((r * 31 + 127) / 255) << 11)
+        | (((g * 63 + 127) / 255) << 5) | ((b * 31 + 127) / 255));
+}
+
+void from565(uint16 c, int out[3])
+{
+    const int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+// endpoints on the principal axis of the colors, four colors mode
+void encodeBcColor(const Pixels &px, unsigned char *out)
+{
+    double mean[3] = { 0, 0, 0 };
+    for (uint32 i = 0; i < 16; i++)
+        for (uint32 c = 0; c < 3; c++)
+            mean[c] += px[i][c] / 16.0;
+    double cov[3][3] = {};
+    for (uint32 i = 0; i < 16; i++)
+    {
+        double d[3];
+        for (uint32 c = 0; c < 3; c++)
+            d[c] = px[i][c] - mean[c];
+        for (uint32 a = 0; a < 3; a++)
+            for (uint32 b = 0; b < 3; b++)
+                cov[a][b] += d[a] * d[b];
+    }
+    double axis[3] = { 1, 1, 1 };
+    for (uint32 it = 0; it < 6; it++)
+    {
+        double v[3];
+        for (uint32 a = 0; a < 3; a++)
+            v[a] = cov[a][0] * axis[0] + cov[a][1] * axis[1]
+                + cov[a][2] * axis[2];
+        const double l = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        if (l < 1e-7)
+            break;
+        for (uint32 a = 0; a < 3; a++)
+            axis[a] = v[a] / l;
+    }
+    double tMin = std::numeric_limits<double>::infinity();
+    double tMax = -tMin;
+    for (uint32 i = 0; i < 16; i++)
+    {
+        double t = 0;
+        for (uint32 c = 0; c < 3; c++)
+            t += (px[i][c] - mean[c]) * axis[c];
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+    }
+    double e0[3], e1[3];
+    for (uint32 c = 0; c < 3; c++)
+    {
+        e0[c] = mean[c] + axis[c] * tMax;
+        e1[c] = mean[c] + axis[c] * tMin;
+    }
+    uint16 c0 = to565(e0), c1 = to565(e1);
+    if (c0 < c1)
+        std::swap(c0, c1);
+    uint32 indices = 0;
+    if (c0 != c1)
+    {
+        int pal[4][3];
+        from565(c0, pal[0]);
+        from565(c1, pal[1]);
+        for (uint32 c = 0; c < 3; c++)
+        {
+            pal[2][c] = (2 * pal[0][c] + pal[1][c]) / 3;
+            pal[3][c] = (pal[0][c] + 2 * pal[1][c]) / 3;
+        }
+        for (uint32 i = 0; i < 16; i++)
+        {
+            uint32 best = 0;
+            int bestErr = std::numeric_limits<int>::max();
+            for (uint32 j = 0; j < 4; j++)
+            {
+                const int e = sqr(px[i][0] - pal[j][0])
+                    + sqr(px[i][1] - pal[j][1])
+                    + sqr(px[i][2] - pal[j][2]);
+                if (e < bestErr)
+                {
+                    bestErr = e;
+                    best = j;
+                }
+            }
+            indices |= best << (2 * i);
+        }
+    }
+    out[0] = c0 & 0xff;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 0xff;
+    out[3] = c1 >> 8;
+    for (uint32 i = 0; i < 4; i++)
+        out[4 + i] = (indices >> (8 * i)) & 0xff;
+}
+
+void encodeBcAlpha(const Pixels &px, unsigned char *out)
+{
+    int a0 = 0, a1 = 255;
+    for (uint32 i = 0; i < 16; i++)
+    {
+        a0 = std::max(a0, px[i][3]);
+        a1 = std::min(a1, px[i][3]);
+    }
+    uint64 bits = 0;
+    if (a0 != a1)
+    {
+        int pal[8];
+        pal[0] = a0;
+        pal[1] = a1;
+        for (uint32 j = 2; j < 8; j++)
+            pal[j] = ((8 - j) * a0 + (j - 1) * a1) / 7;
+        for (uint32 i = 0; i < 16; i++)
+        {
+            uint64 best = 0;
+            int bestErr = 256;
+            for (uint32 j = 0; j < 8; j++)
+            {
+                const int e = std::abs(px[i][3] - pal[j]);
+                if (e < bestErr)
+                {
+                    bestErr = e;
+                    best = j;
+                }
+            }
+            bits |= best << (3 * i);
+        }
+    }
+    out[0] = a0;
+    out[1] = a1;
+    for (uint32 i = 0; i < 6; i++)
+        out[2 + i] = (bits >> (8 * i)) & 0xff;
+}
+
+////////////////////////////
+// ETC2
+////////////////////////////
+
+const int EtcTables[8][2] = {
+    { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 },
+    { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 } };
+
+const int EacTables[16][8] = {
+    { -3, -6, -9, -15, 2, 5, 8, 14 },
+    { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5, -8, -13, 1, 4, 7, 12 },
+    { -2, -4, -6, -13, 1, 3, 5, 12 },
+    { -3, -6, -8, -12, 2, 5, 7, 11 },
+    { -3, -7, -9, -11, 2, 6, 8, 10 },
+    { -4, -7, -8, -11, 3, 6, 7, 10 },
+    { -3, -5, -8, -11, 2, 4, 7, 10 },
+    { -2, -6, -8, -10, 1, 5, 7, 9 },
+    { -2, -5, -8, -10, 1, 4, 7, 9 },
+    { -2, -4, -8, -10, 1, 3, 7, 9 },
+    { -2, -5, -7, -10, 1, 4, 6, 9 },
+    { -3, -4, -7, -10, 2, 3, 6, 9 },
+    { -1, -2, -3, -10, 0, 1, 2, 9 },
+    { -4, -6, -8, -9, 3, 5, 7, 8 },
+    { -3, -5, -7, -9, 2, 4, 6, 8 } };
+
+// pixel index (msb, lsb): 00 = +a, 01 = +b, 10 = -a, 11 = -b
+int etcModifier(uint32 table, uint32 index)
+{
+    const int v = EtcTables[table][index & 1];
+    return index & 2 ? -v : v;
+}
+
+struct EtcSubblock
+{
+    uint32 pixels[8]; // indices into the block, row major
+    uint32 table;
+    uint32 indices[8];
+};
+
+int etcEvaluate(const Pixels &px, const int base[3], EtcSubblock &sb,
+    int limit)
+{
+    int best = limit;
+    for (uint32 t = 0; t < 8; t++)
+    {
+        int err = 0;
+        uint32 idx[8];
+        for (uint32 p = 0; p < 8 && err < best; p++)
+        {
+            const int *c = px[sb.pixels[p]];
+            int be = std::numeric_limits<int>::max();
+            for (uint32 m = 0; m < 4; m++)
+            {
+                const int mod = etcModifier(t, m);
+                const int e = sqr(clamp255(base[0] + mod) - c[0])
+                    + sqr(clamp255(base[1] + mod) - c[1])
+                    + sqr(clamp255(base[2] + mod) - c[2]);
+                if (e < be)
+                {
+                    be = e;
+                    idx[p] = m;
+                }
+            }
+            err += be;
+        }
+        if (err < best)
+        {
+            best = err;
+            sb.table = t;
+            std::copy(idx, idx + 8, sb.indices);
+        }
+    }
+    return best;
+}
+
+// individual and differential modes only (compatible with etc1)
+void encodeEtcColor(const Pixels &px, unsigned char *out)
+{
+    uint64 bestWord = 0;
+    int bestErr = std::numeric_limits<int>::max();
+    for (uint32 flip = 0; flip < 2; flip++)
+    {
+        EtcSubblock sb[2];
+        double avg[2][3] = {};
+        for (uint32 s = 0; s < 2; s++)
+        {
+            uint32 n = 0;
+            for (uint32 y = 0; y < 4; y++)
+            {
+                for (uint32 x = 0; x < 4; x++)
+                {
+                    if ((flip ? y / 2 : x / 2) != s)
+                        continue;
+                    sb[s].pixels[n++] = y * 4 + x;
+                    for (uint32 c = 0; c < 3; c++)
+                        avg[s][c] += px[y * 4 + x][c] / 8.0;
+                }
+            }
+        }
+
+        for (uint32 diff = 0; diff < 2; diff++)
+        {
+            int q[2][3], base[2][3];
+            bool valid = true;
+            for (uint32 s = 0; s < 2; s++)
+            {
+                for (uint32 c = 0; c < 3; c++)
+                {
+                    if (diff)
+                    {
+                        q[s][c] = std::min(31, (int)(avg[s][c] * 31 / 255 + 0.5));
+                        base[s][c] = (q[s][c] << 3) | (q[s][c] >> 2);
+                    }
+                    else
+                    {
+                        q[s][c] = std::min(15, (int)(avg[s][c] * 15 / 255 + 0.5));
+                        base[s][c] = q[s][c] * 17;
+                    }
+                }
+            }
+            if (diff)
+            {
+                for (uint32 c = 0; c < 3; c++)
+                {
+                    const int d = q[1][c] - q[0][c];
+                    if (d < -4 || d > 3)
+                        valid = false;
+                }
+            }
+            if (!valid)
+                continue;
+
+            int err = etcEvaluate(px, base[0], sb[0], bestErr);
+            if (err >= bestErr)
+                continue;
+            err += etcEvaluate(px, base[1], sb[1], bestErr - err);
+            if (err >= bestErr)
+                continue;
+            bestErr = err;
+
+            uint64 w = 0;
+            for (uint32 c = 0; c < 3; c++)
+            {
+                const uint32 shift = 56 - c * 8;
+                if (diff)
+                {
+                    const uint64 d = (q[1][c] - q[0][c]) & 7;
+                    w |= (uint64)q[0][c] << (shift + 3);
+                    w |= d << shift;
+                }
+                else
+                {
+                    w |= (uint64)q[0][c] << (shift + 4);
+                    w |= (uint64)q[1][c] << shift;
+                }
+            }
+            w |= (uint64)sb[0].table << 37;
+            w |= (uint64)sb[1].table << 34;
+            w |= (uint64)diff << 33;
+            w |= (uint64)flip << 32;
+            for (uint32 s = 0; s < 2; s++)
+            {
+                for (uint32 p = 0; p < 8; p++)
+                {
+                    // pixels are indexed in column major order
+                    const uint32 i = sb[s].pixels[p];
+                    const uint32 k = (i % 4) * 4 + i / 4;
+                    const uint32 m = sb[s].indices[p];
+                    w |= (uint64)(m >> 1) << (16 + k);
+                    w |= (uint64)(m & 1) << k;
+                }
+            }
+            bestWord = w;
+        }
+    }
+    for (uint32 i = 0; i < 8; i++)
+        out[i] = (bestWord >> (56 - 8 * i)) & 0xff;
+}
+
+void encodeEacAlpha(const Pixels &px, unsigned char *out)
+{
+    int aMin = 255, aMax = 0;
+    for (uint32 i = 0; i < 16; i++)
+    {
+        aMin = std::min(aMin, px[i][3]);
+        aMax = std::max(aMax, px[i][3]);
+    }
+    // constant alpha is encoded exactly with zero modifier
+    uint64 base = aMin, mult = 1, table = 13;
+    uint64 indices = 0;
+    for (uint32 k = 0; k < 16; k++)
+        indices |= (uint64)4 << (45 - 3 * k);
+    if (aMin != aMax)
+    {
+        const int b = (aMin + aMax + 1) / 2;
+        int bestErr = std::numeric_limits<int>::max();
+        for (uint32 t = 0; t < 16; t++)
+        {
+            const int span = EacTables[t][7] - EacTables[t][3];
+            const int m0 = (aMax - aMin + span / 2) / span;
+            for (int m = std::max(1, m0 - 1); m <= std::min(15, m0 + 1); m++)
+            {
+                int err = 0;
+                uint64 idx = 0;
+                for (uint32 k = 0; k < 16 && err < bestErr; k++)
+                {
+                    // pixels are indexed in column major order
+                    const int a = px[(k % 4) * 4 + k / 4][3];
+                    int be = std::numeric_limits<int>::max();
+                    uint64 bi = 0;
+                    for (uint32 j = 0; j < 8; j++)
+                    {
+                        const int e = sqr(clamp255(b + EacTables[t][j] * m) - a);
+                        if (e < be)
+                        {
+                            be = e;
+                            bi = j;
+                        }
+                    }
+                    err += be;
+                    idx |= bi << (45 - 3 * k);
+                }
+                if (err < bestErr)
+                {
+                    bestErr = err;
+                    base = b;
+                    mult = m;
+                    table = t;
+                    indices = idx;
+                }
+            }
+        }
+    }
+    const uint64 w = (base << 56) | (mult << 52) | (table << 48) | indices;
+    for (uint32 i = 0; i < 8; i++)
+        out[i] = (w >> (56 - 8 * i)) & 0xff;
+}
+
+// placeholder for the formats without alpha
+void encodeNoAlpha(const Pixels &, unsigned char *)
+{}
+
+template<bool HasAlpha,
+         void (*Alpha)(const Pixels &, unsigned char *),
+         void (*Color)(const Pixels &, unsigned char *)>
+void compressBlocks(const unsigned char *in, uint32 width, uint32 height,
+    uint32 components, unsigned char *out)
+{
+    const uint32 bw = (width + 3) / 4, bh = (height + 3) / 4;
+    Pixels px;
+    for (uint32 by = 0; by < bh; by++)
+    {
+        for (uint32 bx = 0; bx < bw; bx++)
+        {
+            fetchBlock(in, width, height, components, bx, by, px);
+            if (HasAlpha)
+            {
+                Alpha(px, out);
+                out += 8;
+            }
+            Color(px, out);
+            out += 8;
+        }
+    }
+}
+
+} // namespace
+
+void compressBc1(const unsigned char *in, uint32 width, uint32 height,
+    uint32 components, unsigned char *out)
+{
+    compressBlocks<false, &encodeNoAlpha, &encodeBcColor>(in, width, height,
+        components, out);
+}
+
+void compressBc3(const unsigned char *in, uint32 width, uint32 height,
+    uint32 components, unsigned char *out)
+{
+    compressBlocks<true, &encodeBcAlpha, &encodeBcColor>(in, width, height,
+        components, out);
+}
+
+void compressEtc2Rgb(const unsigned char *in, uint32 width, uint32 height,
+    uint32 components, unsigned char *out)
+{
+    compressBlocks<false, &encodeNoAlpha, &encodeEtcColor>(in, width, height,
+        components, out);
+}
+
+void compressEtc2Rgba(const unsigned char *in, uint32 width, uint32 height,
+    uint32 components, unsigned char *out)
+{
+    compressBlocks<true, &encodeEacAlpha, &encodeEtcColor>(in, width, height,
+        components, out);
+}
+
+} // namespace vts
@@ -28,14 +28,58 @@
 
 #include <dbglog/dbglog.hpp>
 #include <cstdio>
+#include <cstring>
+#include <cmath>
 
 #include <optick.h>
 
 namespace vts
 {
 
+namespace
+{
+
+bool isWebp(const Buffer &in)
+{
+    return in.size() >= 12
+        && memcmp(in.data(), "RIFF", 4) == 0
+        && memcmp(in.data() + 8, "WEBP", 4) == 0;
+}
+
+bool isAvif(const Buffer &in)
+{
+    // iso base media file with avif major brand
+    return in.size() >= 12
+        && memcmp(in.data() + 4, "ftyp", 4) == 0
+        && (memcmp(in.data() + 8, "avif", 4) == 0
+            || memcmp(in.data() + 8, "avis", 4) == 0);
+}
+
+} // namespace
+
+const std::string &imageAcceptHeader()
+{
+    static const std::string accept = std::string()
+#ifdef VTS_BROWSER_AVIF
+        + "image/avif,"
+#endif
+#ifdef VTS_BROWSER_WEBP
+        + "image/webp,"
+#endif
+        + "image/png,image/jpeg,*/*;q=0.8";
+    return accept;
+}
+
 void decodeImage(const Buffer &in, Buffer &out,
                  uint32 &width, uint32 &height, uint32 &components)
+{
+    uint32 scale = 1;
+    decodeImage(in, out, width, height, components, scale);
+}
+
+void decodeImage(const Buffer &in, Buffer &out,
+                 uint32 &width, uint32 &height, uint32 &components,
+                 uint32 &scale, bool flip)
 {
     if (in.size() < 8)
         LOGTHROW(err1, std::runtime_error) << "insufficient image data";
@@ -46,22 +90,60 @@ void decodeImage(const Buffer &in, Buffer &out,
     if (memcmp(in.data(), pngSignature, sizeof(pngSignature)) == 0)
     {
         OPTICK_EVENT("decode png");
-        decodePng(in, out, width, height, components);
+        decodePng(in, out, width, height, components, flip);
+        scale = 1;
     }
     else if (memcmp(in.data(), jpegSignature, sizeof(jpegSignature)) == 0)
     {
         OPTICK_EVENT("decode jpeg");
-        decodeJpeg(in, out, width, height, components);
+        // the dct scaling supports power of two denominators up to 8
+        uint32 s = 1;
+        while (s < 8 && s * 2 <= scale)
+            s *= 2;
+        scale = s;
+        decodeJpeg(in, out, width, height, components, scale, flip);
+    }
+    else if (isWebp(in))
+    {
+#ifdef VTS_BROWSER_WEBP
+        OPTICK_EVENT("decode webp");
+        decodeWebp(in, out, width, height, components, flip);
+        scale = 1;
+#else
+        LOGTHROW(err1, std::runtime_error)
+            << "webp image support is not available in this build";
+#endif
+    }
+    else if (isAvif(in))
+    {
+#ifdef VTS_BROWSER_AVIF
+        OPTICK_EVENT("decode avif");
+        decodeAvif(in, out, width, height, components, flip);
+        scale = 1;
+#else
+        LOGTHROW(err1, std::runtime_error)
+            << "avif image support is not available in this build";
+#endif
     }
     else
     {
         // raw image data - assume square
         OPTICK_EVENT("decode raw image");
+        scale = 1;
         components = 4;
         width = height = std::sqrt(in.size() / components);
         if (in.size() != width * height * components)
             LOGTHROW(err1, std::runtime_error) << "Raw image is not square";
-        out = in.copy();
+        if (flip)
+        {
+            const uint32 lineSize = width * components;
+            out = Buffer(in.size());
+            for (uint32 y = 0; y < height; y++)
+                memcpy(out.data() + (height - y - 1) * lineSize,
+                    in.data() + y * lineSize, lineSize);
+        }
+        else
+            out = in.copy();
     }
 }
 
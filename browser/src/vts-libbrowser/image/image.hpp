@@ -29,21 +29,65 @@
 
 #include "../include/vts-browser/buffer.hpp"
 
+#include <string>
+
 namespace vts
 {
 
+// flip: store the rows bottom-up (as expected by opengl)
+
 void decodePng(const Buffer &in, Buffer &out,
-               uint32 &width, uint32 &height, uint32 &components);
+               uint32 &width, uint32 &height, uint32 &components,
+               bool flip = false);
 
+// scale is denominator of the output resolution: 1, 2, 4 or 8
 void decodeJpeg(const Buffer &in, Buffer &out,
-                uint32 &width, uint32 &height, uint32 &components);
+                uint32 &width, uint32 &height, uint32 &components,
+                uint32 scale = 1, bool flip = false);
+
+// optional formats, available when built with VTS_BROWSER_WEBP
+//   or VTS_BROWSER_AVIF respectively
+void decodeWebp(const Buffer &in, Buffer &out,
+                uint32 &width, uint32 &height, uint32 &components,
+                bool flip = false);
+void decodeAvif(const Buffer &in, Buffer &out,
+                uint32 &width, uint32 &height, uint32 &components,
+                bool flip = false);
+
+// value for the http Accept header listing the decodable image formats
+const std::string &imageAcceptHeader();
 
 void decodeImage(const Buffer &in, Buffer &out,
                  uint32 &width, uint32 &height, uint32 &components);
 
+// decode at reduced resolution (1 / scale) where the format allows it
+//   the scale is updated to the one actually used
+void decodeImage(const Buffer &in, Buffer &out,
+                 uint32 &width, uint32 &height, uint32 &components,
+                 uint32 &scale, bool flip = false);
+
 void encodePng(const Buffer &in, Buffer &out,
                uint32 width, uint32 height, uint32 components);
 
+// block compression of 8 bit images with 3 or 4 components
+// the output has 8 (bc1, etc2 rgb) or 16 (bc3, etc2 rgba) bytes
+//   for each 4x4 block, blocks are in row major order
+void compressBc1(const unsigned char *in, uint32 width, uint32 height,
+                 uint32 components, unsigned char *out);
+void compressBc3(const unsigned char *in, uint32 width, uint32 height,
+                 uint32 components, unsigned char *out);
+void compressEtc2Rgb(const unsigned char *in, uint32 width, uint32 height,
+                     uint32 components, unsigned char *out);
+void compressEtc2Rgba(const unsigned char *in, uint32 width, uint32 height,
+                      uint32 components, unsigned char *out);
+
+// half resolution (box filter) of 8 bit image
+// gamma: average color channels in linear space (srgb),
+//   the alpha channel is always averaged directly
+void downsampleImage(const Buffer &in, Buffer &out,
+                     uint32 &width, uint32 &height, uint32 components,
+                     bool gamma);
+
 } // namespace vts
 
 #endif
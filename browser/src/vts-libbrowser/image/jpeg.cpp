@@ -48,7 +48,8 @@ void jpegErrFunc(j_common_ptr cinfo)
 } // namespace
 
 void decodeJpeg(const Buffer &in, Buffer &out,
-                uint32 &width, uint32 &height, uint32 &components)
+                uint32 &width, uint32 &height, uint32 &components,
+                uint32 scale, bool flip)
 {
     jpeg_decompress_struct info;
     jpeg_error_mgr errmgr;
@@ -59,6 +60,12 @@ void decodeJpeg(const Buffer &in, Buffer &out,
         jpeg_create_decompress(&info);
         jpeg_mem_src(&info, (unsigned char*)in.data(), in.size());
         jpeg_read_header(&info, TRUE);
+        if (scale > 1)
+        {
+            // the idct produces the reduced image directly
+            info.scale_num = 1;
+            info.scale_denom = scale;
+        }
         jpeg_start_decompress(&info);
         width = info.output_width;
         height = info.output_height;
@@ -68,8 +75,9 @@ void decodeJpeg(const Buffer &in, Buffer &out,
         while (info.output_scanline < info.output_height)
         {
             unsigned char *ptr[1];
-            ptr[0] = (unsigned char*)out.data()
-                    + lineSize * info.output_scanline;
+            const uint32 y = flip
+                ? height - info.output_scanline - 1 : info.output_scanline;
+            ptr[0] = (unsigned char*)out.data() + lineSize * y;
             jpeg_read_scanlines(&info, ptr, 1);
         }
         jpeg_finish_decompress(&info);
@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace vts
+{
+
+namespace
+{
+
+// conversion between 8 bit values and 12 bit linear values
+// the filter is scalar, the table lookups (gathers)
+//   keep the compiler from vectorizing the loops
+struct Tables
+{
+    uint16 toLinear[256];
+    unsigned char fromLinear[4096];
+
+    Tables(bool gamma)
+    {
+        for (uint32 i = 0; i < 256; i++)
+        {
+            double v = i / 255.0;
+            if (gamma)
+                v = v <= 0.04045 ? v / 12.92
+                    : std::pow((v + 0.055) / 1.055, 2.4);
+            toLinear[i] = (uint16)(v * 4095 + 0.5);
+        }
+        for (uint32 i = 0; i < 4096; i++)
+        {
+            double v = i / 4095.0;
+            if (gamma)
+                v = v <= 0.0031308 ? v * 12.92
+                    : 1.055 * std::pow(v, 1 / 2.4) - 0.055;
+            fromLinear[i] = (unsigned char)(v * 255 + 0.5);
+        }
+    }
+};
+
+const Tables &tables(bool gamma)
+{
+    static const Tables srgb(true);
+    static const Tables linear(false);
+    return gamma ? srgb : linear;
+}
+
+} // namespace
+
+void downsampleImage(const Buffer &in, Buffer &out,
+    uint32 &width, uint32 &height, uint32 components, bool gamma)
+{
+    const uint32 w = std::max(width / 2, 1u), h = std::max(height / 2, 1u);
+    out = Buffer(w * h * components);
+    const unsigned char *s = (const unsigned char *)in.data();
+    unsigned char *d = (unsigned char *)out.data();
+
+    // color channels are averaged in linear space, alpha is not
+    const Tables *tabs[4];
+    for (uint32 c = 0; c < 4; c++)
+        tabs[c] = &tables(gamma && c < 3 && components >= 3);
+
+    const uint32 rowSize = width * components;
+    std::vector<uint16> sums(rowSize);
+    for (uint32 y = 0; y < h; y++)
+    {
+        // vertical pass
+        const unsigned char *r0 = s + std::min(y * 2, height - 1) * rowSize;
+        const unsigned char *r1 = s
+            + std::min(y * 2 + 1, height - 1) * rowSize;
+        for (uint32 c = 0; c < components; c++)
+        {
+            const uint16 *lin = tabs[c]->toLinear;
+            for (uint32 i = c; i < rowSize; i += components)
+                sums[i] = lin[r0[i]] + lin[r1[i]];
+        }
+
+        // horizontal pass
+        unsigned char *o = d + y * w * components;
+        const uint32 step = width > 1 ? components : 0;
+        for (uint32 c = 0; c < components; c++)
+        {
+            const unsigned char *from = tabs[c]->fromLinear;
+            const uint16 *p = sums.data() + c;
+            for (uint32 x = 0; x < w; x++)
+            {
+                const uint32 v = p[0] + p[step];
+                o[x * components + c] = from[(v + 2) / 4];
+                p += 2 * components;
+            }
+        }
+    }
+    width = w;
+    height = h;
+}
+
+} // namespace vts
@@ -0,0 +1,63 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image.hpp"
+
+#include <webp/decode.h>
+#include <dbglog/dbglog.hpp>
+
+namespace vts
+{
+
+void decodeWebp(const Buffer &in, Buffer &out,
+                uint32 &width, uint32 &height, uint32 &components,
+                bool flip)
+{
+    WebPDecoderConfig config;
+    if (!WebPInitDecoderConfig(&config))
+        LOGTHROW(err1, std::runtime_error) << "incompatible libwebp version";
+    if (WebPGetFeatures((const uint8_t*)in.data(), in.size(),
+        &config.input) != VP8_STATUS_OK)
+        LOGTHROW(err1, std::runtime_error) << "invalid webp image header";
+    width = config.input.width;
+    height = config.input.height;
+    components = config.input.has_alpha ? 4 : 3;
+    out = Buffer(width * height * components);
+    config.options.flip = flip;
+    config.output.colorspace = components == 4 ? MODE_RGBA : MODE_RGB;
+    config.output.is_external_memory = 1;
+    config.output.u.RGBA.rgba = (uint8_t*)out.data();
+    config.output.u.RGBA.stride = width * components;
+    config.output.u.RGBA.size = out.size();
+    VP8StatusCode status = WebPDecode((const uint8_t*)in.data(),
+        in.size(), &config);
+    WebPFreeDecBuffer(&config.output);
+    if (status != VP8_STATUS_OK)
+        LOGTHROW(err1, std::runtime_error)
+            << "failed to decode webp image <" << (int)status << ">";
+}
+
+} // namespace vts
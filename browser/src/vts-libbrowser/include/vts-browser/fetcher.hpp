@@ -106,6 +106,11 @@ public:
     explicit FetchTask(const std::string &url, ResourceType resourceType);
     virtual ~FetchTask();
     virtual void fetchDone() = 0;
+
+    // current importance of the download, higher is more important
+    // may change while the task is waiting in the fetcher
+    // must be thread-safe
+    virtual float priority() const;
 };
 
 class VTS_API FetcherOptions
@@ -136,6 +141,44 @@ public:
     // 2 = use http/2, fallback http/1
     // 3 = use http/2, fallback http/1.1
     sint32 pipelining = 2;
+
+    // send priority of each download to the server
+    //   as http urgency (Priority request header, RFC 9218)
+    //   and dispatch waiting downloads in order of their priority
+    bool streamPriorities = true;
+
+    // adapt number of concurrent downloads for each host
+    //   additive increase while the host responds well
+    //   multiplicative decrease on timeouts, 429/503 or rising latency
+    // maxHostConnections (if not zero) limits the window
+    bool adaptiveHostConnections = false;
+
+    // ask servers for compressed (gzip) transfer of non-image resources
+    //   and decompress the replies in the fetcher
+    bool compression = true;
+
+    // open connections to hosts from the mapconfig ahead of the downloads
+    //   done with a minimal request to the host root
+    //   (the http library has no connect-only or head request)
+    bool preconnect = false;
+
+    // record all downloads (including replies and latencies)
+    //   into an archive at this path
+    std::string recordPath;
+
+    // serve all downloads from an archive at this path
+    //   instead of the network
+    std::string replayPath;
+
+    // latency of replayed downloads
+    // 0 = no latency
+    // 1 = latency as recorded
+    // 2 = uniformly distributed in replayLatencyMin .. replayLatencyMax
+    uint32 replayLatency = 1;
+
+    // in milliseconds
+    uint32 replayLatencyMin = 50;
+    uint32 replayLatencyMax = 200;
 };
 
 class VTS_API Fetcher : private Immovable
@@ -143,11 +186,37 @@ class VTS_API Fetcher : private Immovable
 public:
     static std::shared_ptr<Fetcher> create(const FetcherOptions &options);
 
+    // wraps another fetcher and records all downloads
+    //   into an archive at options.recordPath
+    static std::shared_ptr<Fetcher> createRecorder(
+        const FetcherOptions &options,
+        const std::shared_ptr<Fetcher> &fetcher);
+
+    // serves all downloads from an archive at options.replayPath
+    //   with latency defined by options.replayLatency
+    static std::shared_ptr<Fetcher> createReplay(
+        const FetcherOptions &options);
+
     virtual ~Fetcher();
     virtual void initialize();
     virtual void finalize();
     virtual void update();
+
+    // time in milliseconds until the fetcher needs next call to update
+    // update is always called after each finished download
+    // -1 = no periodic updates are needed
+    // defaults to 10 ms polling
+    virtual sint32 updateTimeout();
     virtual void fetch(const std::shared_ptr<FetchTask> &) = 0;
+
+    // hint that downloads from the origin (scheme://host[:port])
+    //   will follow soon, the fetcher may resolve the host
+    //   and open a connection ahead of time
+    virtual void preconnect(const std::string &origin);
+
+    // current number of allowed concurrent downloads for each host
+    // must be thread-safe
+    virtual std::map<std::string, uint32> hostConnectionsWindows();
 };
 
 } // namespace vts
@@ -53,6 +53,13 @@ public:
     // invoked from Map::dataTick()
     std::function<void(class ResourceInfo &, class GpuGeodataSpec &, const std::string &id)> loadGeodata;
 
+    // function callback to test whether the gpu supports
+    //   the compressed texture format (GpuTextureSpec::Compression)
+    // invoked from the decode thread
+    // the textures are not compressed in unsupported formats
+    // if not set, all formats are assumed supported
+    std::function<bool(uint32 format)> textureCompressionSupported;
+
     // function callback when the mapconfig is downloaded
     // invoked from Map::renderTick()
     // suitable to change view, position, etc.
@@ -65,9 +65,25 @@ public:
     std::string customSrs1;
     std::string customSrs2;
 
+    // deepest lod of meta tiles, meshes and internal textures
+    //   that are included in the startup snapshot
+    uint32 startupSnapshotLod = 3;
+
     // use hard drive cache for downloads
     bool diskCache;
 
+    // keep mapconfig, authentication, external layers and top-level tiles
+    //   in the disk cache and start the map from them immediately
+    //   (works offline too), the snapshot is revalidated in background
+    // requires diskCache
+    bool startupSnapshot = false;
+
+    // store decoded textures in the disk cache too
+    //   and skip the image decoding on revisits
+    //   (trades disk space for cpu time)
+    // requires diskCache
+    bool decodedTextureCache = false;
+
     // true -> use new scheme for naming (hashing) files
     //         in a hierarchy of directories in the cache
     // false -> use old scheme where the name of the downloaded resource
@@ -128,6 +144,95 @@ public:
     // each subsequent retry is delayed twice as long as before
     uint32 fetchFirstRetryTimeOffset = 1;
 
+    // number of consecutive failed downloads from a host
+    //   after which all downloads from the host are suspended
+    //   and only a single probe is attempted after fetchBreakerOpenTime
+    // 0 = disabled
+    uint32 fetchBreakerFailures = 5;
+
+    // time in seconds for which the downloads are suspended
+    // each subsequent suspension is twice as long (up to 16x)
+    uint32 fetchBreakerOpenTime = 5;
+
+    // relative shares of downloads for classes of resources
+    //   when multiple classes are waiting in the queue
+    // within each class, resources with higher priority go first
+    uint32 fetchShareMeta = 8; // meta tiles, bound meta tiles, nav tiles
+    uint32 fetchShareMesh = 4;
+    uint32 fetchShareTexture = 4;
+    uint32 fetchShareGeodata = 2; // features, stylesheets, fonts
+    uint32 fetchShareConfig = 16; // mapconfig, layers configs, search, ...
+
+    // regular expression matching urls of meta tiles, nav tiles
+    //   and geodata features that may be downloaded in batches
+    // the first capture group is the tile id, other parts of the url
+    //   identify the layer
+    // queued downloads from the same layer are coalesced into single
+    //   request with the ids joined by comma in place of the group,
+    //   e.g. .../15-1000-2000,15-1001-2000.meta
+    // the server replies with multipart/mixed content with one part
+    //   for each id, in the same order or identified by Content-Location
+    // empty = disabled
+    std::string fetchBatchPattern;
+
+    // maximum number of resources in single batch request
+    uint32 fetchBatchMax = 16;
+
+    // number of most used resources remembered for each mapconfig
+    // on next start, they are read from the disk cache and decoded
+    //   while the mapconfig is loading
+    // the warm-up is limited to half of targetResourcesMemoryKB
+    // 0 = disabled
+    uint32 hotSetSize = 0;
+
+    // memory for raw (still encoded) content of recently decoded
+    //   textures, meshes, meta tiles and nav tiles
+    // it is a least recently used pool of everything decoded,
+    //   not only of evicted resources,
+    //   evicted resources are moved to its front
+    // it must exceed the raw size of the resources in use
+    //   for the evicted ones to stay in it
+    // evicted resources are reloaded from here
+    //   instead of the disk cache or network
+    // 0 = disabled
+    uint32 ramCacheMemoryKB = 65536;
+
+    // when estimated time to download all queued resources
+    //   (from measured throughput) exceeds this budget (in milliseconds),
+    //   targetPixelRatioSurfaces is temporarily scaled up
+    //   until the network catches up
+    // 0 = disabled (default), 3000 is a reasonable budget
+    uint32 fetchTimeBudget = 0;
+
+    // maximum scale applied to targetPixelRatioSurfaces
+    double fetchLodScaleMax = 4;
+
+    // decode jpeg surface textures at reduced resolution (1/2 .. 1/8)
+    //   when their texels are much finer than the screen pixels
+    // the textures are decoded again when more detail is needed
+    bool textureDecodeScaling = true;
+
+    // generate texture mipmaps on the decode thread
+    //   instead of on the gpu at upload time
+    bool textureMipmapsOnDecode = true;
+
+    // reorder mesh triangles and vertices for the gpu vertex cache
+    bool meshCacheOptimization = true;
+
+    // store mesh positions as normalized uint16 instead of float
+    // the dequantization is part of the model matrix
+    // applications with custom loadMesh must respect the vertex attributes
+    bool meshQuantization = false;
+
+    // compress surface textures on the decode thread
+    //   including generated mipmaps
+    // textures stay uncompressed if the gpu does not support the format
+    //   (see MapCallbacks::textureCompressionSupported)
+    // 0 = no compression
+    // 1 = bc1/bc3 (s3tc, desktop)
+    // 2 = etc2 (opengl es 3)
+    uint32 textureCompression = 0;
+
     // 0 = US customary units
     // 1 = metric
     // when new instance of this structure is created,
@@ -140,6 +245,11 @@ public:
     bool debugValidateGeodataStyles = false;
     bool debugCoarsenessDisks = true;
     bool debugExtractRawResources = false;
+
+    // decode meshes with both the direct parser and vtslibs
+    //   and compare the results (the vtslibs result is used)
+    // meshes not handled by the direct parser are logged as fallbacks
+    bool debugValidateMeshParser = false;
 };
 
 } // namespace vts
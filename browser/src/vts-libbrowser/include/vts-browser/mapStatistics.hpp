@@ -28,6 +28,7 @@
 #define MAP_STATISTICS_HPP_wqieufhbvgjh
 
 #include <string>
+#include <map>
 
 #include "foundation.hpp"
 
@@ -42,6 +43,7 @@ public:
     uint32 resourcesCreated = 0;
     uint32 resourcesDownloaded = 0;
     uint32 resourcesDiskLoaded = 0;
+    uint32 resourcesRamLoaded = 0;
     uint32 resourcesDecoded = 0;
     uint32 resourcesUploaded = 0;
     uint32 resourcesFailed = 0;
@@ -59,10 +61,33 @@ public:
     uint32 resourcesQueueAtmosphere = 0;
     uint32 resourcesAccessed = 0;
 
+    // classes of downloads: meta, mesh, texture, geodata, config
+    static constexpr uint32 FetchClasses = 5;
+    uint32 resourcesQueueDownloadPerClass[FetchClasses] = {};
+    uint32 resourcesDownloadWaitMsPerClass[FetchClasses] = {}; // smoothed time in the queue
+
     uint32 currentGpuMemUseKB = 0;
     uint32 currentRamMemUseKB = 0;
+    uint32 currentRamCacheKB = 0;
+
+    // smoothed download throughput, while downloading
+    uint32 downloadThroughputKBps = 0;
+    // scale of targetPixelRatioSurfaces due to slow network
+    double downloadLodScale = 1;
+
+    // metanodes generated from decoded metatiles
+    uint32 metaNodesGenerated = 0;
+    // smoothed speed of the metanodes generation
+    uint32 metaNodesPerSecond = 0;
 
     uint32 renderTicks = 0;
+
+    // number of allowed concurrent downloads for each host
+    //   as adapted by the fetcher
+    std::map<std::string, uint32> hostConnectionsWindows;
+
+    // time from setting the mapconfig path to first rendered tile
+    uint32 timeToFirstFrameMs = 0;
 };
 
 } // namespace vts
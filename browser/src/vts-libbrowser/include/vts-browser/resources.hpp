@@ -69,7 +69,9 @@ class VTS_API GpuTextureSpec
 {
 public:
     GpuTextureSpec() = default;
-    explicit GpuTextureSpec(const Buffer &buffer); // decode jpg or png file
+    // decode jpg or png file
+    // bottomUp: the first row in the buffer is the bottom of the image
+    explicit GpuTextureSpec(const Buffer &buffer, bool bottomUp = false);
     void verticalFlip();
 
     // image resolution
@@ -88,11 +90,41 @@ public:
     // raw texture data
     // it has (width * height * components * gpuTypeSize(type)) bytes
     // the rows are in no way aligned to multi-byte boundaries (GL_UNPACK_ALIGNMENT = 1)
+    // compressed textures contain the blocks of all mipmap levels,
+    //   starting with the largest one
     Buffer buffer;
 
+    enum class Compression
+    {
+        // compatible with OpenGL
+        None = 0,
+        Bc1 = 0x83F0, // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+        Bc3 = 0x83F3, // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+        Etc2Rgb = 0x9274, // GL_COMPRESSED_RGB8_ETC2
+        Etc2Rgba = 0x9278, // GL_COMPRESSED_RGBA8_ETC2_EAC
+    } compression = Compression::None;
+
+    // number of mipmap levels in the buffer
+    uint32 mipmapLevels = 1;
+
     // expected size based on width * height * components * gpuTypeSize(type)
+    //   or the size of all blocks of compressed texture
     uint32 expectedSize() const;
 
+    // size of one mipmap level in the buffer
+    uint32 levelSize(uint32 level) const;
+
+    // generate all mipmap levels of 8 bit texture
+    // color is filtered in linear space
+    void generateMipmaps();
+
+    // block compress 8 bit rgb or rgba texture
+    //   bc1 or etc2 rgb is used for textures without transparency
+    //   the mipmap chain is generated, unless already present
+    // desktop: bc = true, bc1 and bc3
+    // mobile: bc = false, etc2
+    void compress(bool bc);
+
     // encode the image into png format
     Buffer encodePng() const;
 
@@ -28,6 +28,7 @@
 #define MAP_HPP_cvukikljqwdf
 
 #include <vector>
+#include <chrono>
 
 #include <vts-libs/registry/referenceframe.hpp>
 
@@ -68,6 +69,7 @@ class BoundMetaTile;
 class SearchTaskImpl;
 class TilesetMapping;
 class GeodataFeatures;
+class GeodataFeatureStore;
 class GeodataStylesheet;
 class GeodataStylesheet;
 class GeodataTile;
@@ -97,6 +99,7 @@ public:
     std::string authPath;
     std::string mapconfigPath;
     std::string mapconfigView;
+    std::chrono::steady_clock::time_point mapconfigPathTime;
     double lastElapsedFrameTime = 0;
     uint32 progressEstimationMaxResources = 0;
     uint32 renderTickIndex = 0;
@@ -114,10 +117,11 @@ public:
     // rendering
     void renderUpdate(double elapsedTime);
     bool prerequisitesCheck();
+    void preconnectHosts();
     void initializeNavigation();
     std::pair<Validity, std::shared_ptr<GeodataStylesheet>> getActualGeoStyle(const std::string &name);
-    std::pair<Validity, std::shared_ptr<const std::string>> getActualGeoFeatures(const std::string &name, const std::string &geoName, float priority);
-    std::pair<Validity, std::shared_ptr<const std::string>> getActualGeoFeatures(const std::string &name);
+    std::pair<Validity, std::shared_ptr<const GeodataFeatureStore>> getActualGeoFeatures(const std::string &name, const std::string &geoName, float priority);
+    std::pair<Validity, std::shared_ptr<const std::string>> getActualGeoFeaturesJson(const std::string &name);
     void traverseClearing(TraverseNode *trav);
 
     // resources methods
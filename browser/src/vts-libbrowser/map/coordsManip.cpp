@@ -188,6 +188,14 @@ public:
         //LOG(debug) << "Converted <" << value.transpose() << "><" << f << "> to <" << res.transpose() << "><" << t << ">";
         return res;
     }
+
+    void convert(const vec3 *in, vec3 *out, uint32 count, const std::string &f, const std::string &t)
+    {
+        // the convertor is looked up once for all points
+        const auto &cs = convertor(f, t);
+        for (uint32 i = 0; i < count; i++)
+            out[i] = vecFromUblas<vec3>(cs(vecFromUblas<math::Point3>(in[i])));
+    }
 };
 
 } // namespace
@@ -234,6 +242,14 @@ vec3 CoordManip::convert(const vec3 &value, Srs from, const std::string &to)
     return impl->convert(value, impl->srsToProj(from), to);
 }
 
+void CoordManip::convert(const vec3 *in, vec3 *out, uint32 count, const std::string &from, Srs to)
+{
+    if (count == 0)
+        return;
+    CoordManipImpl *impl = (CoordManipImpl *)this;
+    impl->convert(in, out, count, from, impl->srsToProj(to));
+}
+
 vec3 CoordManip::geoDirect(const vec3 &position, double distance, double azimuthIn, double &azimuthOut)
 {
     CoordManipImpl *impl = (CoordManipImpl *)this;
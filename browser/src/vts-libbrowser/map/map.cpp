@@ -42,6 +42,8 @@
 
 #include <optick.h>
 
+#include <set>
+
 namespace vts
 {
 
@@ -172,9 +174,61 @@ void MapImpl::setMapconfigPath(const std::string &mapconfigPath,
     LOG(info3) << "Changing mapconfig path to <" << mapconfigPath << ">, "
         << (!authPath.empty() ? "using" : "without")
         << " authentication";
+    resources->hotSetSave();
     this->mapconfigPath = mapconfigPath;
     this->authPath = authPath;
+    mapconfigPathTime = std::chrono::steady_clock::now();
+    statistics.timeToFirstFrameMs = 0;
     purgeMapconfig();
+    resources->hotSetLoad();
+}
+
+void MapImpl::preconnectHosts()
+{
+    std::set<std::string> origins;
+    const auto add = [&](const std::string &url) {
+        const std::string path = convertPath(url, mapconfigPath);
+        auto s = path.find("://");
+        if (s == std::string::npos)
+            return;
+        std::string origin = path.substr(0, path.find('/', s + 3));
+        if (origin.find('{') != std::string::npos)
+            return; // the host itself is templated
+        origins.insert(origin);
+    };
+    for (const auto &it : mapconfig->surfaces)
+    {
+        add(it.urls3d->meta);
+        add(it.urls3d->mesh);
+        add(it.urls3d->texture);
+    }
+    for (const auto &it : mapconfig->glues)
+    {
+        add(it.urls3d->meta);
+        add(it.urls3d->mesh);
+        add(it.urls3d->texture);
+    }
+    for (const auto &it : mapconfig->boundLayers)
+    {
+        add(it.url);
+        if (it.metaUrl)
+            add(*it.metaUrl);
+        if (it.maskUrl)
+            add(*it.maskUrl);
+    }
+    for (const auto &it : mapconfig->freeLayers)
+    {
+        if (it.second.external())
+            add(it.second.externalUrl());
+    }
+
+    // connection to the mapconfig host is already open
+    const auto s = mapconfigPath.find("://");
+    if (s != std::string::npos)
+        origins.erase(mapconfigPath.substr(0, mapconfigPath.find('/', s + 3)));
+
+    for (const auto &it : origins)
+        resources->preconnect(it);
 }
 
 bool MapImpl::prerequisitesCheck()
@@ -210,6 +264,7 @@ bool MapImpl::prerequisitesCheck()
             createOptions.customSrs2);
 
         credits->merge(mapconfig.get());
+        preconnectHosts();
         initializeNavigation();
         mapconfig->initializeCelestialBody();
 
@@ -225,7 +225,7 @@ std::pair<Validity, std::shared_ptr<GeodataStylesheet>>
     return { f->stylesheet->dependencies(), f->stylesheet };
 }
 
-std::pair<Validity, std::shared_ptr<const std::string>>
+std::pair<Validity, std::shared_ptr<const GeodataFeatureStore>>
     MapImpl::getActualGeoFeatures(const std::string &name,
         const std::string &geoName, float priority)
 {
@@ -236,24 +236,43 @@ std::pair<Validity, std::shared_ptr<const std::string>>
     assert(layer->freeLayer);
     if (layer->freeLayer->type == vtslibs::registry::FreeLayer::Type::geodata
             && layer->freeLayer->overrideGeodata)
-        return { Validity::Valid, layer->freeLayer->overrideGeodata };
+    {
+        // the store is missing if the override failed to parse
+        const auto &s = layer->freeLayer->overrideGeodataStore;
+        return { s ? Validity::Valid : Validity::Invalid, s };
+    }
 
     if (geoName.empty())
         return { Validity::Invalid, {} };
 
     auto g = getGeoFeatures(geoName);
+    if (layer->freeLayer->type == vtslibs::registry::FreeLayer::Type::geodata)
+        g->keepJson = true;
     g->updatePriority(priority);
-    return { getResourceValidity(g), g->data };
+    return { getResourceValidity(g), g->store };
 }
 
 std::pair<Validity, std::shared_ptr<const std::string>>
-    MapImpl::getActualGeoFeatures(const std::string &name)
+    MapImpl::getActualGeoFeaturesJson(const std::string &name)
 {
     MapLayer *layer = getLayer(this, name);
+    if (!layer)
+        return { Validity::Invalid, {} };
+
     assert(layer->freeLayer->type
            == vtslibs::registry::FreeLayer::Type::geodata);
-    return getActualGeoFeatures(name,
-        layer->surfaceStack.surfaces[0].urlGeodata({}), inf1());
+    if (layer->freeLayer->overrideGeodata)
+        return { Validity::Valid, layer->freeLayer->overrideGeodata };
+
+    const std::string geoName
+        = layer->surfaceStack.surfaces[0].urlGeodata({});
+    if (geoName.empty())
+        return { Validity::Invalid, {} };
+
+    auto g = getGeoFeatures(geoName);
+    g->keepJson = true;
+    g->updatePriority(inf1());
+    return { getResourceValidity(g), g->data };
 }
 
 } // namespace vts
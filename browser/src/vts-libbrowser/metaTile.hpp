@@ -29,6 +29,8 @@
 
 #include <vts-libs/vts/metatile.hpp>
 
+#include <array>
+
 #include "include/vts-browser/math.hpp"
 #include "resource.hpp"
 
@@ -50,9 +52,9 @@ public:
     uint8 flags[vtslibs::registry::BoundLayer::rasterMetatileWidth * vtslibs::registry::BoundLayer::rasterMetatileHeight];
 };
 
-class MetaNode
+// full precision values of a metanode, used while generating it
+struct MetaNodeData
 {
-public:
     struct Obb
     {
         mat4 rotInv;
@@ -71,8 +73,57 @@ public:
     double diskHalfAngle;
     double texelSize;
 
+    MetaNodeData();
+};
+
+// compact metanode
+// physical positions are stored as float offsets from the node origin
+//   (the only double precision position)
+// the boxes are rounded outwards
+class MetaNode
+{
+public:
+    using Obb = MetaNodeData::Obb;
+
     MetaNode();
-    vec3 cornersPhys(uint32 index) const;
+    explicit MetaNode(const MetaNodeData &data);
+
+    TileId tileId;
+    TileId localId;
+    Extents2 extents;
+
+    // the values are decompressed on each call,
+    //   call sites that use them repeatedly should keep a copy
+    vec3 aabbPhys(uint32 index) const;
+    std::array<vec3, 8> cornersPhys() const;
+    bool obb(Obb &result) const; // false when the node has no obb
+    boost::optional<vec3> surrogatePhys() const;
+    boost::optional<float> surrogateNav() const;
+    vec3 diskNormalPhys() const;
+    vec2 diskHeightsPhys() const;
+    double diskHalfAngle() const { return diskAngle; }
+    double texelSize() const { return texel; }
+
+private:
+    enum Flags : uint8
+    {
+        HasAabb = 1 << 0,
+        HasObb = 1 << 1,
+        HasSurrogate = 1 << 2,
+    };
+
+    vec3 origin;
+    vec3f aabb[2];
+    mat3f obbRot;
+    vec3f obbCenter;
+    vec3f obbPoints[2];
+    vec3f surrogate;
+    float surrogateNavValue;
+    vec3f diskNormal;
+    float diskHeights[2]; // relative to the length of the origin
+    float diskAngle;
+    float texel;
+    uint8 flags;
 };
 
 Extents2 subExtents(const Extents2 &parentExtents, const TileId &parentId, const TileId &targetId);
@@ -86,11 +137,18 @@ public:
     MetaTile(MapImpl *map, const std::string &name);
     void decode() override;
     FetchTask::ResourceType resourceType() const override;
+    // the metanode is generated on first access
+    //   (together with its siblings)
+    // uses the main thread convertor
+    // returns null if the generation failed
     std::shared_ptr<const MetaNode> getNode(const TileId &tileId);
 
 private:
+    bool generateNodes(const TileId &tileId);
+
     std::weak_ptr<Mapconfig> mapconfig;
-    std::vector<boost::optional<MetaNode>> metas;
+    // each node owns its storage so that it outlives a reload
+    std::vector<std::shared_ptr<const MetaNode>> metas;
 };
 
 } // namespace vts
@@ -42,6 +42,7 @@ using vtslibs::vts::UrlTemplate;
 enum class Validity;
 
 class GeodataStylesheet;
+class GeodataFeatureStore;
 class CameraImpl;
 class GpuTexture;
 class MapImpl;
@@ -67,6 +68,7 @@ public:
 
     std::shared_ptr<GeodataStylesheet> stylesheet;
     std::shared_ptr<const std::string> overrideGeodata; // monolithic only
+    std::shared_ptr<const GeodataFeatureStore> overrideGeodataStore;
 };
 
 class BoundParamInfo : public vtslibs::registry::View::BoundLayerParams
@@ -31,6 +31,7 @@
 #include <string>
 #include <atomic>
 #include <ctime>
+#include <chrono>
 
 #include "include/vts-browser/resources.hpp"
 #include "include/vts-browser/fetcher.hpp"
@@ -64,9 +65,12 @@ public:
     virtual void decode() = 0; // eg. decode an image
     virtual void upload() {} // call the resource callback
     virtual bool requiresUpload() { return false; }
+    virtual bool readDecodedCache() { return false; } // fills decodeData, the content is not needed then
     virtual FetchTask::ResourceType resourceType() const = 0;
     bool allowDiskCache() const;
     static bool allowDiskCache(FetchTask::ResourceType type);
+    bool allowSnapshot() const;
+    bool allowRamCache() const;
     void updatePriority(float priority);
     void updateAvailability(const std::shared_ptr<void> &availTest);
     void forceRedownload();
@@ -82,7 +86,14 @@ public:
     std::time_t retryTime = -1;
     uint32 retryNumber = 0;
     uint32 lastAccessTick = 0;
+    uint32 accessCount = 0; // number of render ticks the resource was accessed in
     float priority = 0;
+    bool snapshotTile = false; // top-level tile included in startup snapshot
+    std::atomic<bool> warmup {false}; // created by hot set warm-up and not yet accessed by the map
+    std::atomic<bool> upgrading {false}; // the old gpu data remain in use while new version is prepared
+    ResourceInfo upgradeInfo; // the new version, swapped in by the main thread
+    std::time_t upgradeRetryTime = 0; // after a failed upgrade
+    std::chrono::steady_clock::time_point fetchQueueTime;
 };
 
 std::ostream &operator << (std::ostream &stream, Resource::State state);
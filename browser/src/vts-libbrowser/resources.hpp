@@ -29,13 +29,20 @@
 
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
+#include <list>
 #include <vector>
 #include <atomic>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <chrono>
+#include <random>
+#include <regex>
+#include <set>
 
 #include "../include/vts-browser/buffer.hpp"
+#include "../include/vts-browser/mapStatistics.hpp"
 
 #include "../utilities/threadName.hpp"
 #include "../validity.hpp"
@@ -53,6 +60,7 @@ class Cache;
 class AuthConfig;
 class SearchTask;
 class SearchTaskImpl;
+class FetchTask;
 class FetchTaskImpl;
 class GeodataTile;
 
@@ -76,6 +84,41 @@ public:
     std::string name;
     sint64 expires = 0;
     bool availFailed = false;
+    bool stale = false; // read from startup snapshot, must be revalidated
+};
+
+class HotSetEntry
+{
+public:
+    uint32 type = 0; // FetchTask::ResourceType
+    uint32 accessCount = 0;
+    uint32 memoryCost = 0;
+};
+
+// suspends fetches from a failing host
+class HostBreaker
+{
+public:
+    enum class State
+    {
+        closed, // fetches are allowed
+        open, // fetches fail immediately
+        halfOpen, // single probe fetch is allowed
+    };
+
+    State state = State::closed;
+    uint32 failures = 0; // consecutive
+    uint32 openings = 0; // consecutive, prolongs the open state
+    std::chrono::steady_clock::time_point reopen;
+    bool probing = false;
+};
+
+// suspends batch downloads from a host after transient failures
+class BatchBackoff
+{
+public:
+    uint32 failures = 0; // consecutive
+    std::chrono::steady_clock::time_point resume;
 };
 
 class UploadData
@@ -96,7 +139,8 @@ protected:
     std::shared_ptr<void> destroyData;
 };
 
-template<class Item, void (Resources::*Process)(Item), float (Resources::*Priority)(const Item &), int ThreadName>
+// Select (optional) overrides choosing the item with highest priority
+template<class Item, void (Resources::*Process)(Item), float (Resources::*Priority)(const Item &), int ThreadName, uint32 (Resources::*Select)(const std::vector<Item> &) = nullptr>
 class ResourceProcessor : private Immovable
 {
 public:
@@ -184,6 +228,7 @@ public:
     void cacheReadProcess(const std::shared_ptr<Resource> &r);
 
     void fetcherProcessorEntry();
+    void fetchWakeup();
 
     void removeOld();
     void checkInitialized();
@@ -193,7 +238,34 @@ public:
 
     void cacheInit();
     void cacheWrite(const CacheData &data);
-    CacheData cacheRead(const std::string &name);
+    CacheData cacheRead(const std::string &name, bool snapshot = false);
+    void ramCacheWrite(CacheData &&data);
+    CacheData ramCacheRead(const std::string &name);
+    void ramCacheTouch(const std::string &name); // move to the most recent
+
+    void snapshotRevalidate(const std::shared_ptr<Resource> &r);
+    void snapshotFetch();
+    bool batchFetch(const std::shared_ptr<Resource> &r);
+    bool batchMatch(FetchTaskImpl &t);
+    void batchReport(const std::string &key, uint32 code, bool valid);
+    void batchUpdate();
+    void preconnect(const std::string &origin);
+    void preconnectFetch();
+    void snapshotUpdate();
+
+    bool hotSetPrepare(const Resource &r, HotSetEntry &e);
+    void hotSetRecord(const std::string &name, const HotSetEntry &e);
+    void hotSetLoad();
+    void hotSetSave(bool synchronous = false); // synchronous when finalizing
+    void hotSetUpdate();
+    void throughputUpdate();
+    void upgradeStart(const std::shared_ptr<Resource> &r);
+    void upgradeFinish(const std::shared_ptr<Resource> &r);
+    void upgradeAbort(const std::shared_ptr<Resource> &r);
+
+    bool breakerAllow(const std::string &url);
+    void breakerReport(const std::string &url, uint32 code);
+    sint32 breakerResume(); // returns milliseconds until next host reopens, or -1
 
     void oneCacheRead(std::weak_ptr<Resource> r);
     void oneFetch(std::weak_ptr<Resource> r);
@@ -205,8 +277,9 @@ public:
     float priority(const std::weak_ptr<GeodataTile> &r);
     float priority(const CacheData &) { return 0; };
     float priority(const UploadData &) { return 0; };
+    uint32 fetchSelect(const std::vector<std::weak_ptr<Resource>> &q);
 
-    ResourceProcessor<std::weak_ptr<Resource>, &Resources::oneFetch, &Resources::priority, 0> queFetching;
+    ResourceProcessor<std::weak_ptr<Resource>, &Resources::oneFetch, &Resources::priority, 0, &Resources::fetchSelect> queFetching;
     ResourceProcessor<std::weak_ptr<Resource>, &Resources::oneCacheRead, &Resources::priority, 1> queCacheRead;
     ResourceProcessor<CacheData, &Resources::oneCacheWrite, &Resources::priority, 2> queCacheWrite;
     ResourceProcessor<std::weak_ptr<Resource>, &Resources::oneDecode, &Resources::priority, 3> queDecode;
@@ -215,13 +288,51 @@ public:
 
     std::unordered_map<std::string, std::shared_ptr<Resource>> resources;
     MapImpl *const map;
+    std::mutex snapshotMut;
+    std::vector<std::shared_ptr<FetchTask>> snapshotRevalidations; // waiting for the fetcher thread
+    std::vector<std::string> snapshotChanged; // resources that differ from the snapshot
+    std::unordered_set<std::string> snapshotRevalidated;
+    std::unordered_map<std::string, HotSetEntry> hotSet; // access histogram for current mapconfig
+    std::vector<std::shared_ptr<Resource>> hotSetWarmup; // keeps the warmed-up resources alive
+    std::mutex ramCacheMut;
+    std::list<CacheData> ramCacheItems; // most recently written first
+    std::unordered_map<std::string, std::list<CacheData>::iterator> ramCacheIndex;
+    uint64 ramCacheSize = 0;
+    std::mutex breakersMut;
+    std::unordered_map<std::string, HostBreaker> breakers;
+    // fetches held while their host is failing, by host, fetch thread only
+    std::unordered_map<std::string, std::vector<std::weak_ptr<Resource>>> breakerSuspended;
+    std::mt19937 retryRandom {std::random_device()()};
+    // weighted fair queuing of downloads, guarded by queFetching.mut
+    double fetchVirtualTime[MapStatistics::FetchClasses] = {};
+    uint32 fetchClassDepth[MapStatistics::FetchClasses] = {};
+    uint32 fetchClassWaitMs[MapStatistics::FetchClasses] = {};
+    uint32 fetchWakeups = 0; // guarded by queFetching.mut
+    std::string batchPatternOption; // copied from the runtime options by the main thread, guarded by batchMut
+    std::string batchPatternSource; // fetch thread only
+    std::regex batchPattern; // fetch thread only
+    uint32 batchPatternVersion = 0; // fetch thread only
+    std::mutex batchMut;
+    std::set<std::string> batchDisabled; // layer keys
+    std::unordered_map<std::string, BatchBackoff> batchBackoffs; // hosts
+    std::atomic<uint64> bytesDownloaded{0};
+    std::atomic<uint32> downloadsCompleted{0};
+    std::chrono::steady_clock::time_point throughputTime;
+    uint64 throughputBytes = 0;
+    uint32 throughputCount = 0;
+    bool throughputBusy = false;
+    double throughput = 0; // bytes per second, smoothed
+    double averageDownloadSize = 0; // bytes, smoothed
+    double downloadLodScale = 1;
+    std::mutex preconnectMut;
+    std::vector<std::string> preconnectOrigins;
     std::atomic<uint32> downloads{ 0 }; // number of active downloads
     std::atomic<uint32> existing{ 0 }; // number of existing resources
     std::atomic<bool> renderFinalizeCalled{ false };
 };
 
-template<class Item, void (Resources::*Process)(Item), float (Resources::*Priority)(const Item &), int ThreadName>
-inline bool ResourceProcessor<Item, Process, Priority, ThreadName>::runOne()
+template<class Item, void (Resources::*Process)(Item), float (Resources::*Priority)(const Item &), int ThreadName, uint32 (Resources::*Select)(const std::vector<Item> &)>
+inline bool ResourceProcessor<Item, Process, Priority, ThreadName, Select>::runOne()
 {
     OPTICK_EVENT("runOne");
     Item item;
@@ -238,8 +349,8 @@ inline bool ResourceProcessor<Item, Process, Priority, ThreadName>::runOne()
     return true;
 }
 
-template<class Item, void (Resources::*Process)(Item), float (Resources::*Priority)(const Item &), int ThreadName>
-inline void ResourceProcessor<Item, Process, Priority, ThreadName>::entry()
+template<class Item, void (Resources::*Process)(Item), float (Resources::*Priority)(const Item &), int ThreadName, uint32 (Resources::*Select)(const std::vector<Item> &)>
+inline void ResourceProcessor<Item, Process, Priority, ThreadName, Select>::entry()
 {
     constexpr const char *ThreadNames[] =
     {
@@ -271,10 +382,17 @@ inline void ResourceProcessor<Item, Process, Priority, ThreadName>::entry()
     }
 }
 
-template<class Item, void (Resources::*Process)(Item), float (Resources::*Priority)(const Item &), int ThreadName>
-inline Item ResourceProcessor<Item, Process, Priority, ThreadName>::getBest()
+template<class Item, void (Resources::*Process)(Item), float (Resources::*Priority)(const Item &), int ThreadName, uint32 (Resources::*Select)(const std::vector<Item> &)>
+inline Item ResourceProcessor<Item, Process, Priority, ThreadName, Select>::getBest()
 {
     OPTICK_EVENT("getBest");
+    if (Select)
+    {
+        auto b = q.begin() + (resources->*Select)(q);
+        auto r = std::move(*b);
+        q.erase(b);
+        return r;
+    }
     auto it = q.begin();
     auto et = q.end();
     auto b = it;
@@ -28,6 +28,7 @@
 
 #include "../authConfig.hpp"
 #include "../fetchTask.hpp"
+#include "../utilities/url.hpp"
 
 #include <ctime>
 #include <jsoncpp/json.hpp>
@@ -39,21 +40,6 @@ namespace vts
 namespace
 {
 
-const std::string extractUrlHost(const std::string &url)
-{
-    auto a = url.find("://");
-    if (a == std::string::npos)
-        a = 0;
-    else
-        a += 3;
-
-    auto b = url.find("/", a);
-    if (b == std::string::npos)
-        b = url.length();
-
-    return url.substr(a, b - a);
-}
-
 uint64 currentTime()
 {
     std::time_t t = std::time(nullptr);
@@ -131,15 +117,28 @@ void AuthConfig::checkTime()
 }
 
 void AuthConfig::authorize(const std::shared_ptr<Resource> &task)
+{
+    authorize(task->name, task->fetch->query);
+}
+
+void AuthConfig::authorize(const std::string &name, FetchTask::Query &query)
 {
     if (!hostnames.empty())
     {
-        std::string h = extractUrlHost(task->name);
+        std::string h = extractUrlHost(name);
         if (hostnames.find(h) == hostnames.end())
             return;
     }
-    task->fetch->query.headers["Accept"] = std::string()
-            + "token/" + token + ", */*";
+    // keep the content types requested by the resource
+    std::string &accept = query.headers["Accept"];
+    if (accept.compare(0, 6, "token/") == 0)
+    {
+        // authorized previously
+        const auto p = accept.find(", ");
+        accept = p == std::string::npos ? "" : accept.substr(p + 2);
+    }
+    accept = std::string()
+            + "token/" + token + ", " + (accept.empty() ? "*/*" : accept);
 }
 
 } // namespace vts
@@ -0,0 +1,416 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../include/vts-browser/log.hpp"
+
+#include "../fetchTask.hpp"
+#include "../resources.hpp"
+#include "../resource.hpp"
+#include "../authConfig.hpp"
+#include "../map.hpp"
+#include "../utilities/url.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <optick.h>
+
+namespace vts
+{
+
+namespace
+{
+
+bool batchType(FetchTask::ResourceType type)
+{
+    switch (type)
+    {
+    case FetchTask::ResourceType::MetaTile:
+    case FetchTask::ResourceType::BoundMetaTile:
+    case FetchTask::ResourceType::NavTile:
+    case FetchTask::ResourceType::GeodataFeatures:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// splits the url around the first capture group of the pattern
+bool batchSplit(const std::regex &pattern, const std::string &url,
+    std::string &prefix, std::string &suffix, std::string &id)
+{
+    std::smatch m;
+    if (!std::regex_match(url, m, pattern) || m.size() < 2
+        || !m[1].matched || m.length(1) == 0)
+        return false;
+    prefix = url.substr(0, m.position(1));
+    suffix = url.substr(m.position(1) + m.length(1));
+    id = m.str(1);
+    return true;
+}
+
+struct Part
+{
+    std::string contentType;
+    std::string location;
+    const char *data = nullptr;
+    uint32 size = 0;
+};
+
+std::string toLower(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(), ::tolower);
+    return s;
+}
+
+std::string trim(const std::string &s)
+{
+    auto b = s.find_first_not_of(" \t\"");
+    if (b == std::string::npos)
+        return "";
+    auto e = s.find_last_not_of(" \t\"");
+    return s.substr(b, e + 1 - b);
+}
+
+const char *find(const char *b, const char *e, const std::string &what)
+{
+    return std::search(b, e, what.begin(), what.end());
+}
+
+// parses multipart/mixed content (RFC 2046)
+bool parseMultipart(const Buffer &content, const std::string &contentType,
+    std::vector<Part> &parts)
+{
+    const std::string ct = toLower(contentType);
+    if (ct.compare(0, 10, "multipart/") != 0)
+        return false;
+    auto bp = ct.find("boundary=");
+    if (bp == std::string::npos)
+        return false;
+    // the boundary is case sensitive
+    std::string boundary = contentType.substr(bp + 9);
+    boundary = trim(boundary.substr(0, boundary.find(';')));
+    if (boundary.empty())
+        return false;
+    const std::string delim = "--" + boundary;
+    const std::string crlf = "\r\n";
+    const char *const e = content.dataEnd();
+    const char *p = find(content.data(), e, delim);
+    while (p != e)
+    {
+        p += delim.size();
+        if (e - p >= 2 && p[0] == '-' && p[1] == '-')
+            return true; // closing delimiter
+        p = find(p, e, crlf);
+        if (p == e)
+            return false;
+        p += 2;
+        Part part;
+        // headers
+        while (true)
+        {
+            const char *le = find(p, e, crlf);
+            if (le == e)
+                return false;
+            if (le == p)
+                break;
+            std::string line(p, le);
+            p = le + 2;
+            auto c = line.find(':');
+            if (c == std::string::npos)
+                continue;
+            const std::string name = toLower(trim(line.substr(0, c)));
+            if (name == "content-type")
+                part.contentType = trim(line.substr(c + 1));
+            else if (name == "content-location")
+                part.location = trim(line.substr(c + 1));
+        }
+        p += 2;
+        // body
+        const char *be = find(p, e, crlf + delim);
+        if (be == e)
+            return false;
+        part.data = p;
+        part.size = be - p;
+        parts.push_back(part);
+        p = be + 2;
+    }
+    return false;
+}
+
+} // namespace
+
+BatchFetchTask::BatchFetchTask(MapImpl *map, const std::string &url,
+    const std::string &key,
+    std::vector<std::shared_ptr<FetchTaskImpl>> &&members,
+    std::vector<std::string> &&ids) :
+    FetchTask(url, members[0]->query.resourceType), map(map), key(key),
+    members(std::move(members)), ids(std::move(ids))
+{
+    reply.expires = -1;
+}
+
+float BatchFetchTask::priority() const
+{
+    float p = 0;
+    for (const auto &m : members)
+        p = std::max(p, m->priority());
+    return p;
+}
+
+////////////////////////////
+// A FETCH THREAD
+////////////////////////////
+
+void BatchFetchTask::fetchDone()
+{
+    OPTICK_EVENT();
+    LOG(debug) << "Batch <" << query.url << "> finished downloading, "
+               << "http code: " << reply.code << ", content type: <"
+               << reply.contentType << ">, size: " << reply.content.size();
+
+    std::vector<Part> parts;
+    const bool valid = reply.code == 200
+        && parseMultipart(reply.content, reply.contentType, parts);
+    map->resources->batchReport(key, reply.code, valid);
+
+    // the batch is a single request to the host,
+    //   the delivered parts are reported again by the members
+    map->resources->breakerReport(query.url, reply.code);
+
+    // assign the parts to the members
+    std::vector<const Part *> assigned(members.size(), nullptr);
+    for (uint32 j = 0, je = parts.size(); j < je; j++)
+    {
+        const Part &p = parts[j];
+        if (p.location.empty())
+        {
+            if (parts.size() == members.size())
+                assigned[j] = &p;
+            continue;
+        }
+        for (uint32 i = 0, ie = members.size(); i < ie; i++)
+        {
+            if (p.location == ids[i] || p.location == members[i]->query.url)
+                assigned[i] = &p;
+        }
+    }
+
+    bool missing = false;
+    for (uint32 i = 0, ie = members.size(); i < ie; i++)
+    {
+        FetchTaskImpl *m = members[i].get();
+        if (assigned[i])
+        {
+            const Part &p = *assigned[i];
+            m->reply.content.allocate(p.size);
+            memcpy(m->reply.content.data(), p.data, p.size);
+            m->reply.contentType = p.contentType;
+            m->reply.expires = reply.expires;
+            m->reply.code = 200;
+            m->fetchDone();
+            continue;
+        }
+
+        // the resource will be downloaded individually
+        //   and it is excluded from next batches only if the server
+        //   has answered the batch but omitted this resource
+        missing = true;
+        if (valid)
+            m->batchable = false;
+        m->reply = Reply();
+        map->resources->downloads--;
+        std::shared_ptr<Resource> rs = m->resource.lock();
+        if (rs)
+        {
+            assert(rs->state == Resource::State::fetching);
+            rs->state = Resource::State::initializing;
+        }
+    }
+    if (missing)
+        map->resources->fetchWakeup();
+}
+
+bool Resources::batchMatch(FetchTaskImpl &t)
+{
+    if (t.batchPatternVersion != batchPatternVersion)
+    {
+        t.batchPatternVersion = batchPatternVersion;
+        t.batchMatched = batchSplit(batchPattern, t.query.url,
+            t.batchPrefix, t.batchSuffix, t.batchId);
+    }
+    return t.batchMatched;
+}
+
+bool Resources::batchFetch(const std::shared_ptr<Resource> &r)
+{
+    const uint32 batchMax = map->options.fetchBatchMax;
+    if (batchMax < 2 || !r->fetch->batchable
+        || !batchType(r->fetch->query.resourceType))
+        return false;
+
+    {
+        std::lock_guard<std::mutex> lock(batchMut);
+        if (batchPatternSource != batchPatternOption)
+        {
+            batchPatternSource = batchPatternOption;
+            batchPatternVersion++;
+            try
+            {
+                batchPattern = std::regex(batchPatternSource);
+            }
+            catch (const std::regex_error &e)
+            {
+                LOG(err3) << "Invalid fetch batch pattern <"
+                          << batchPatternSource << ">, " << e.what();
+                batchPattern = std::regex(); // matches nothing
+            }
+        }
+    }
+    if (batchPatternSource.empty() || !batchMatch(*r->fetch))
+        return false;
+
+    const std::string &prefix = r->fetch->batchPrefix;
+    const std::string &suffix = r->fetch->batchSuffix;
+    const std::string key = prefix + "{}" + suffix;
+    {
+        std::lock_guard<std::mutex> lock(batchMut);
+        if (batchDisabled.count(key))
+            return false;
+        auto it = batchBackoffs.find(extractUrlHost(key));
+        if (it != batchBackoffs.end()
+            && std::chrono::steady_clock::now() < it->second.resume)
+            return false;
+    }
+
+    // take the most important queued downloads from the same layer
+    std::vector<std::shared_ptr<Resource>> cands;
+    {
+        std::lock_guard<std::mutex> lock(queFetching.mut);
+        for (const auto &w : queFetching.q)
+        {
+            std::shared_ptr<Resource> c = w.lock();
+            if (!c || c->state != Resource::State::fetchQueue
+                || !c->fetch || !c->fetch->batchable
+                || !batchMatch(*c->fetch)
+                || c->fetch->batchPrefix != prefix
+                || c->fetch->batchSuffix != suffix)
+                continue;
+            cands.push_back(c);
+        }
+        if (cands.empty())
+            return false;
+        std::sort(cands.begin(), cands.end(), [](
+            const std::shared_ptr<Resource> &a,
+            const std::shared_ptr<Resource> &b) {
+            return a->priority > b->priority;
+        });
+        if (cands.size() > batchMax - 1)
+            cands.resize(batchMax - 1);
+        auto &q = queFetching.q;
+        q.erase(std::remove_if(q.begin(), q.end(),
+            [&](const std::weak_ptr<Resource> &w) {
+                std::shared_ptr<Resource> c = w.lock();
+                return c && std::find(cands.begin(), cands.end(), c)
+                    != cands.end();
+            }), q.end());
+    }
+    cands.insert(cands.begin(), r);
+
+    std::vector<std::shared_ptr<FetchTaskImpl>> members;
+    std::vector<std::string> ids;
+    std::string url = prefix;
+    for (const auto &c : cands)
+    {
+        if (!ids.empty())
+            url += ",";
+        url += c->fetch->batchId;
+        ids.push_back(c->fetch->batchId);
+        members.push_back(c->fetch);
+        c->state = Resource::State::fetching;
+        downloads++;
+        map->statistics.resourcesDownloaded++;
+    }
+    url += suffix;
+
+    auto batch = std::make_shared<BatchFetchTask>(map, url, key,
+        std::move(members), std::move(ids));
+    LOG(debug) << "Initializing batch fetch of " << cands.size()
+               << " resources, <" << url << ">";
+    batch->query.headers["X-Vts-Client-Id"] = map->createOptions.clientId;
+    if (map->auth)
+        map->auth->authorize(r->name, batch->query);
+    map->fetcher->fetch(batch);
+    return true;
+}
+
+void Resources::batchReport(const std::string &key, uint32 code,
+    bool valid)
+{
+    std::lock_guard<std::mutex> lock(batchMut);
+    if (valid)
+    {
+        batchBackoffs.erase(extractUrlHost(key));
+        return;
+    }
+
+    // client errors and malformed replies mean that the server
+    //   does not support the batches for this layer
+    if (code == 200 || (code >= 400 && code < 500))
+    {
+        if (batchDisabled.insert(key).second)
+        {
+            LOG(warn2) << "Batch downloads for <" << key
+                       << "> are disabled, http code " << code;
+        }
+        return;
+    }
+
+    // other failures (connection errors, timeouts, server errors)
+    //   are transient, the batches to the host are suspended for a while
+    BatchBackoff &b = batchBackoffs[extractUrlHost(key)];
+    b.failures = std::min(b.failures + 1, 6u);
+    const uint32 seconds = 1u << b.failures;
+    b.resume = std::chrono::steady_clock::now()
+        + std::chrono::seconds(seconds);
+    LOG(info3) << "Batch downloads from <" << extractUrlHost(key)
+               << "> are suspended for " << seconds
+               << " seconds, http code " << code;
+}
+
+////////////////////////////
+// MAIN THREAD
+////////////////////////////
+
+void Resources::batchUpdate()
+{
+    // the fetcher thread must not read the options string directly
+    if (batchPatternOption == map->options.fetchBatchPattern)
+        return;
+    std::lock_guard<std::mutex> lock(batchMut);
+    batchPatternOption = map->options.fetchBatchPattern;
+}
+
+} // namespace vts
@@ -130,7 +130,7 @@ public:
 #endif
     }
 
-    CacheData read(const std::string &nameParam)
+    CacheData read(const std::string &nameParam, bool snapshot)
     {
 #ifdef __EMSCRIPTEN__
         return {};
@@ -155,10 +155,13 @@ public:
                 return {};
             sint64 &expires = cd.expires;
             expires = h->expires;
-            if (expires == -2)
-                return {}; // must revalidate
-            if (expires > 0 && expires < std::time(nullptr))
-                return {}; // expired
+            if (expires == -2 || (expires > 0 && expires < std::time(nullptr)))
+            {
+                // must revalidate or expired
+                if (!snapshot)
+                    return {};
+                cd.stale = true;
+            }
             if (name.size() != h->nameLen)
                 return {};
             if (b.size() < sizeof(CacheHeader) + h->nameLen)
@@ -259,9 +262,62 @@ void Resources::cacheWrite(const CacheData &data)
     map->cache->write(data);
 }
 
-CacheData Resources::cacheRead(const std::string &name)
+CacheData Resources::cacheRead(const std::string &name, bool snapshot)
+{
+    return map->cache->read(name, snapshot);
+}
+
+void Resources::ramCacheWrite(CacheData &&data)
 {
-    return map->cache->read(name);
+    const uint64 limit = (uint64)map->options.ramCacheMemoryKB * 1024;
+    if (data.buffer.size() > limit / 4)
+        return;
+    std::lock_guard<std::mutex> lock(ramCacheMut);
+    auto it = ramCacheIndex.find(data.name);
+    if (it != ramCacheIndex.end())
+    {
+        ramCacheSize -= it->second->buffer.size();
+        ramCacheItems.erase(it->second);
+        ramCacheIndex.erase(it);
+    }
+    ramCacheSize += data.buffer.size();
+    ramCacheItems.push_front(std::move(data));
+    ramCacheIndex[ramCacheItems.front().name] = ramCacheItems.begin();
+    // drop the oldest items
+    while (ramCacheSize > limit)
+    {
+        ramCacheSize -= ramCacheItems.back().buffer.size();
+        ramCacheIndex.erase(ramCacheItems.back().name);
+        ramCacheItems.pop_back();
+    }
+}
+
+void Resources::ramCacheTouch(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(ramCacheMut);
+    auto it = ramCacheIndex.find(name);
+    if (it != ramCacheIndex.end())
+        ramCacheItems.splice(ramCacheItems.begin(), ramCacheItems, it->second);
+}
+
+CacheData Resources::ramCacheRead(const std::string &name)
+{
+    // the item is taken out of the cache,
+    //   it is returned once the resource is decoded again
+    CacheData cd;
+    {
+        std::lock_guard<std::mutex> lock(ramCacheMut);
+        auto it = ramCacheIndex.find(name);
+        if (it == ramCacheIndex.end())
+            return {};
+        cd = std::move(*it->second);
+        ramCacheSize -= cd.buffer.size();
+        ramCacheItems.erase(it->second);
+        ramCacheIndex.erase(it);
+    }
+    if (cd.expires == -2 || (cd.expires > 0 && cd.expires < std::time(nullptr)))
+        return {};
+    return cd;
 }
 
 void Resources::purgeResourcesCache()
@@ -43,6 +43,19 @@ void Fetcher::finalize()
 void Fetcher::update()
 {}
 
+void Fetcher::preconnect(const std::string &)
+{}
+
+sint32 Fetcher::updateTimeout()
+{
+    return 10;
+}
+
+std::map<std::string, uint32> Fetcher::hostConnectionsWindows()
+{
+    return {};
+}
+
 FetchTask::Query::Query(const std::string &url,
                         FetchTask::ResourceType resourceType) :
     url(url), resourceType(resourceType)
@@ -58,4 +71,9 @@ FetchTask::FetchTask(const std::string &url, ResourceType resourceType) :
 FetchTask::~FetchTask()
 {}
 
+float FetchTask::priority() const
+{
+    return 0;
+}
+
 } // namespace vts
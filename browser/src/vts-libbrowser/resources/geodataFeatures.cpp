@@ -0,0 +1,286 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../geodata.hpp"
+#include "../utilities/json.hpp"
+
+#include <dbglog/dbglog.hpp>
+
+namespace vts
+{
+
+namespace
+{
+
+// missing or malformed bbox is treated as zeros, as does the processing
+vec3 convertBboxPoint(const Json::Value &v)
+{
+    if (!v.isArray() || v.size() != 3 || !v[0].isNumeric()
+        || !v[1].isNumeric() || !v[2].isNumeric())
+    {
+        LOG(warn2) << "Geodata group bbox point must have 3 coordinates";
+        return vec3(0, 0, 0);
+    }
+    return vec3(v[0].asDouble(), v[1].asDouble(), v[2].asDouble());
+}
+
+} // namespace
+
+GeodataFeatureStore::GeodataFeatureStore(const Json::Value &json)
+{
+    version = json["version"].asInt();
+
+    static const char *const typeNames[3]
+        = { "points", "lines", "polygons" };
+
+    const Json::Value &jgroups = json["groups"];
+    groups.reserve(jgroups.size());
+    for (const Json::Value &jg : jgroups)
+    {
+        Group g;
+        g.id = store(jg["id"]);
+        g.bbox[0] = convertBboxPoint(jg["bbox"][0]);
+        g.bbox[1] = convertBboxPoint(jg["bbox"][1]);
+        g.resolution = jg["resolution"].asDouble();
+        for (uint32 t = 0; t < 3; t++)
+        {
+            g.features[t].begin = features.size();
+            for (const Json::Value &jf : jg[typeNames[t]])
+            {
+                // a malformed feature is skipped, the others are kept
+                const uint32 propertiesSize = properties.size();
+                const uint32 arraysSize = arrays.size();
+                const uint32 pointsSize = points.size();
+                const uint32 indicesSize = indices.size();
+                try
+                {
+                    features.push_back(storeFeature(jf, (Type)t));
+                }
+                catch (const std::exception &e)
+                {
+                    LOG(warn2) << "Skipping geodata feature <"
+                        << jsonToString(jf["id"]) << ">, " << e.what();
+                    properties.resize(propertiesSize);
+                    arrays.resize(arraysSize);
+                    points.resize(pointsSize);
+                    indices.resize(indicesSize);
+                }
+            }
+            g.features[t].end = features.size();
+        }
+        groups.push_back(g);
+    }
+
+    // the parsing is over, release the excess capacity
+    features.shrink_to_fit();
+    properties.shrink_to_fit();
+    arrays.shrink_to_fit();
+    points.shrink_to_fit();
+    indices.shrink_to_fit();
+    strings.shrink_to_fit();
+    ints.shrink_to_fit();
+    reals.shrink_to_fit();
+}
+
+GeodataFeatureStore::Feature GeodataFeatureStore::storeFeature(
+    const Json::Value &jf, Type type)
+{
+    Feature f;
+    f.id = store(jf["id"]);
+
+    // properties
+    f.properties.begin = properties.size();
+    const Json::Value &jp = jf["properties"];
+    if (jp.isObject())
+    {
+        for (auto it = jp.begin(), et = jp.end(); it != et; it++)
+        {
+            const std::string name = it.name();
+            auto k = keyIndices.find(name);
+            if (k == keyIndices.end())
+            {
+                k = keyIndices.emplace(name, keys.size()).first;
+                keys.push_back(name);
+            }
+            Property p;
+            p.key = k->second;
+            p.value = store(*it);
+            properties.push_back(p);
+        }
+    }
+    f.properties.end = properties.size();
+
+    // coordinates
+    f.arrays.begin = arrays.size();
+    switch (type)
+    {
+    case Type::Point:
+        arrays.push_back(storeArray(jf["points"]));
+        break;
+    case Type::Line:
+        for (const Json::Value &jl : jf["lines"])
+            arrays.push_back(storeArray(jl));
+        break;
+    case Type::Polygon:
+    {
+        Json::Value middle;
+        middle.append(jf["middle"]);
+        arrays.push_back(storeArray(middle));
+        const Json::Value &jv = jf["vertices"];
+        if (!jv.isArray() || (jv.size() % 3) != 0)
+            LOGTHROW(debug, std::runtime_error)
+                << "Polygon vertices must be an array"
+                " with size divisible by 3";
+        Range r;
+        r.begin = points.size();
+        for (uint32 i = 0, e = jv.size(); i < e; i += 3)
+            points.emplace_back(jv[i + 0].asFloat(),
+                jv[i + 1].asFloat(), jv[i + 2].asFloat());
+        r.end = points.size();
+        arrays.push_back(r);
+        f.surface.begin = indices.size();
+        for (const Json::Value &ji : jf["surface"])
+            indices.push_back(ji.asUInt());
+        f.surface.end = indices.size();
+    } break;
+    }
+    f.arrays.end = arrays.size();
+    return f;
+}
+
+GeodataFeatureStore::Value GeodataFeatureStore::store(const Json::Value &v)
+{
+    Value r;
+    switch (v.type())
+    {
+    case Json::nullValue:
+        break;
+    case Json::booleanValue:
+        r.type = ValueType::Bool;
+        r.index = v.asBool();
+        break;
+    case Json::intValue:
+        r.type = ValueType::Int;
+        r.index = ints.size();
+        ints.push_back(v.asInt64());
+        break;
+    case Json::uintValue:
+        r.type = ValueType::UInt;
+        r.index = ints.size();
+        ints.push_back((sint64)v.asUInt64());
+        break;
+    case Json::realValue:
+        r.type = ValueType::Real;
+        r.index = reals.size();
+        reals.push_back(v.asDouble());
+        break;
+    case Json::stringValue:
+        r.type = ValueType::String;
+        r.index = strings.size();
+        strings.push_back(v.asString());
+        break;
+    case Json::arrayValue:
+    case Json::objectValue:
+        r.type = ValueType::Json;
+        r.index = strings.size();
+        strings.push_back(jsonToString(v));
+        break;
+    }
+    return r;
+}
+
+GeodataFeatureStore::Range GeodataFeatureStore::storeArray(
+    const Json::Value &v)
+{
+    Range r;
+    r.begin = points.size();
+    for (const Json::Value &p : v)
+    {
+        if (!p.isArray() || p.size() != 3)
+            LOGTHROW(debug, std::runtime_error)
+                << "Point must have 3 coordinates";
+        points.emplace_back(p[0].asFloat(), p[1].asFloat(), p[2].asFloat());
+    }
+    r.end = points.size();
+    return r;
+}
+
+Json::Value GeodataFeatureStore::value(const Value &v) const
+{
+    switch (v.type)
+    {
+    case ValueType::Null:
+        return Json::Value();
+    case ValueType::Bool:
+        return Json::Value(!!v.index);
+    case ValueType::Int:
+        return Json::Value((Json::Int64)ints[v.index]);
+    case ValueType::UInt:
+        return Json::Value((Json::UInt64)ints[v.index]);
+    case ValueType::Real:
+        return Json::Value(reals[v.index]);
+    case ValueType::String:
+        return Json::Value(strings[v.index]);
+    case ValueType::Json:
+        return stringToJson(strings[v.index]);
+    }
+    return Json::Value();
+}
+
+Json::Value GeodataFeatureStore::property(const Feature &f,
+    const std::string &key) const
+{
+    auto k = keyIndices.find(key);
+    if (k == keyIndices.end())
+        return Json::Value();
+    for (uint32 i = f.properties.begin; i < f.properties.end; i++)
+    {
+        const Property &p = properties[i];
+        if (p.key == k->second)
+            return value(p.value);
+    }
+    return Json::Value();
+}
+
+uint32 GeodataFeatureStore::memoryUsage() const
+{
+    std::size_t s = sizeof(*this)
+        + groups.capacity() * sizeof(Group)
+        + features.capacity() * sizeof(Feature)
+        + properties.capacity() * sizeof(Property)
+        + arrays.capacity() * sizeof(Range)
+        + points.capacity() * sizeof(vec3f)
+        + indices.capacity() * sizeof(uint32)
+        + ints.capacity() * sizeof(sint64)
+        + reals.capacity() * sizeof(double);
+    for (const std::string &it : keys)
+        s += sizeof(it) + it.capacity() + sizeof(uint32) * 4;
+    for (const std::string &it : strings)
+        s += sizeof(it) + it.capacity();
+    return s;
+}
+
+} // namespace vts
@@ -243,12 +243,7 @@ static void erase_if(V &v, const std::vector<bool> &pred)
 template<bool Validating>
 struct geoContext
 {
-    enum class Type
-    {
-        Point,
-        Line,
-        Polygon,
-    };
+    typedef GeodataFeatureStore::Type Type;
 
     typedef std::array<float, 3> Point;
 
@@ -400,7 +395,7 @@ struct geoContext
         : data(data),
         stylesheet(data->style.get()),
         style(*data->style->json),
-        features(stringToJson(*data->features)),
+        features(*data->features),
         browserOptions(*data->browserOptions),
         aabbPhys{ data->aabbPhys[0], data->aabbPhys[1] },
         tileId(data->tileId),
@@ -484,47 +479,42 @@ struct geoContext
         if (Validating)
         {
             // check version
-            if (features["version"].asInt() != 1)
+            if (features.version != 1)
             {
                 THROW << "Invalid geodata features <"
                     << data->name << "> version <"
-                    << features["version"].asInt() << ">";
+                    << features.version << ">";
             }
         }
 
         solveInheritance();
 
-        static const std::vector<std::pair<Type, std::string>> allTypes
-            = { { Type::Point, "points" },
-                { Type::Line, "lines" },
-                { Type::Polygon, "polygons"}
-        };
-
         // style layers filtered by valid feature types
         std::map<Type, std::vector<std::string>> typedLayerNames;
         for (Type t : { Type::Point, Type::Line, Type::Polygon })
             typedLayerNames[t] = filterLayersByType(t);
 
         // groups
-        for (const Value &group : features["groups"])
+        for (const GeodataFeatureStore::Group &group : features.groups)
         {
-            this->group.emplace(group);
+            this->group.emplace(features, group);
             // types
-            for (const auto &type : allTypes)
+            for (Type type : { Type::Point, Type::Line, Type::Polygon })
             {
-                this->type.emplace(type.first);
-                const auto &layers = typedLayerNames[type.first];
+                this->type.emplace(type);
+                const auto &layers = typedLayerNames[type];
                 if (layers.empty())
                     continue;
                 // features
-                for (const Value &feature : group[type.second])
+                const auto &range = group.features[(int)type];
+                for (uint32 fi = range.begin; fi < range.end; fi++)
                 {
-                    this->feature.emplace(feature);
+                    this->feature = &features.features[fi];
                     // layers
                     for (const std::string &layerName : layers)
                         processFeatureName(layerName);
                 }
-                this->feature.reset();
+                this->feature = nullptr;
             }
             this->type.reset();
         }
@@ -644,7 +634,7 @@ struct geoContext
         case '@': // constant
             return evaluate(style["constants"][name]);
         case '$': // property
-            return (*feature)["properties"][name.substr(1)];
+            return features.property(*feature, name.substr(1));
         case '&': // ampersand variable
         {
             auto it = ampVariables.find(name);
@@ -660,9 +650,9 @@ struct geoContext
         }
         case '#': // identifier
             if (name == "#id")
-                return (*feature)["id"];
+                return features.value(feature->id);
             if (name == "#group")
-                return group->group["id"];
+                return features.value(group->group.id);
             if (name == "#type")
             {
                 switch (*type)
@@ -1403,7 +1393,8 @@ if (fnc == #NAME) \
             catch (...)
             {
                 LOG(info3)
-                    << "In feature <" << feature->toStyledString()
+                    << "In feature <"
+                    << features.value(feature->id).toStyledString()
                     << "> and layer name <" << layerName << ">";
                 throw;
             }
@@ -2068,7 +2059,7 @@ if (fnc == #NAME) \
     GeodataTile *const data;
     const GeodataStylesheet *const stylesheet;
     Value style;
-    const Value features;
+    const GeodataFeatureStore &features;
     const Value &browserOptions;
     const vec3 aabbPhys[2];
     const TileId tileId;
@@ -2080,15 +2071,16 @@ if (fnc == #NAME) \
 
     struct Group
     {
-        const Value &group;
+        const GeodataFeatureStore &features;
+        const GeodataFeatureStore::Group &group;
 
-        Group(const Value &group) : group(group)
+        Group(const GeodataFeatureStore &features,
+            const GeodataFeatureStore::Group &group)
+            : features(features), group(group)
         {
-            const Value &a = group["bbox"][0];
-            vec3 aa = vec3(a[0].asDouble(), a[1].asDouble(), a[2].asDouble());
-            const Value &b = group["bbox"][1];
-            vec3 bb = vec3(b[0].asDouble(), b[1].asDouble(), b[2].asDouble());
-            double resolution = group["resolution"].asDouble();
+            const vec3 &aa = group.bbox[0];
+            const vec3 &bb = group.bbox[1];
+            double resolution = group.resolution;
             vec3 mm = bb - aa;
             double ms = length(mm) * 0.01;
             if (ms < 1e-15)
@@ -2102,19 +2094,26 @@ if (fnc == #NAME) \
         Point convertPoint(const Value &v) const
         {
             validateArrayLength(v, 3, 3, "Point must have 3 coordinates");
-            vec3 p = vec3(v[0].asDouble(), v[1].asDouble(), v[2].asDouble());
+            return convertPoint(vec3(v[0].asDouble(), v[1].asDouble(),
+                v[2].asDouble()));
+        }
+
+        Point convertPoint(const vec3 &p) const
+        {
             vec3f f = vec3(orthonormalize * p).cast<float>();
             assert(!std::isnan(f[0]) && !std::isnan(f[1]) && !std::isnan(f[2]));
             return { f[0], f[1], f[2] };
         }
 
-        std::vector<Point> convertArray(const Value &v, bool relative) const
+        std::vector<Point> convertArray(
+            const GeodataFeatureStore::Range &r, bool relative) const
         {
             (void)relative; // todo
+            const vec3f *c = features.coordinates(r);
             std::vector<Point> a;
-            a.reserve(v.size());
-            for (const Value &p : v)
-                a.push_back(convertPoint(p));
+            a.reserve(r.size());
+            for (uint32 i = 0, e = r.size(); i < e; i++)
+                a.push_back(convertPoint(vec3(c[i].cast<double>())));
             return a;
         }
 
@@ -2131,7 +2130,7 @@ if (fnc == #NAME) \
 
     boost::optional<Group> group;
     boost::optional<Type> type;
-    boost::optional<const Value &> feature;
+    const GeodataFeatureStore::Feature *feature = nullptr;
 
     std::vector<std::vector<Point>> getFeaturePositions() const
     {
@@ -2140,23 +2139,24 @@ if (fnc == #NAME) \
         {
         case Type::Point:
         {
-            const Value &array1 = (*feature)["points"];
-            result.push_back(group->convertArray(array1, false));
+            result.push_back(group->convertArray(
+                features.arrays[feature->arrays.begin], false));
             // todo d-points
         } break;
         case Type::Line:
         {
-            const Value &array1 = (*feature)["lines"];
-            result.reserve(array1.size());
-            for (const Value &array2 : array1)
-                result.push_back(group->convertArray(array2, false));
+            result.reserve(feature->arrays.size());
+            for (uint32 i = feature->arrays.begin;
+                i < feature->arrays.end; i++)
+                result.push_back(group->convertArray(
+                    features.arrays[i], false));
             // todo d-lines
         } break;
         case Type::Polygon:
         {
-            std::vector<Point> r;
-            r.push_back(group->convertPoint((*feature)["middle"]));
-            result.push_back(r);
+            // the middle point
+            result.push_back(group->convertArray(
+                features.arrays[feature->arrays.begin], false));
         } break;
         }
         return result;
@@ -2166,36 +2166,22 @@ if (fnc == #NAME) \
     {
         std::vector<Point> result;
         assert(*type == Type::Polygon);
-        const Value &array1 = (*feature)["vertices"];
-        if (Validating)
-        {
-            if (!array1.isArray() || (array1.size() % 3) != 0)
-            {
-                THROW << "Polygon vertices must be an array with size divisible by 3";
-            }
-        }
-        std::vector<Point> vertices;
-        vertices.reserve(array1.size());
-        for (uint32 i = 0, e = array1.size(); i < e; i += 3)
-        {
-            Value v;
-            v.resize(3);
-            for (uint32 j = 0; j < 3; j++)
-                v[j] = array1[i + j];
-            vertices.push_back(group->convertPoint(v));
-        }
-        const Value &surface = (*feature)["surface"];
+        // the vertices follow the middle point
+        const std::vector<Point> vertices = group->convertArray(
+            features.arrays[feature->arrays.begin + 1], false);
+        const auto &surface = feature->surface;
         if (Validating)
         {
-            if (!surface.isArray() || (surface.size() % 3) != 0)
+            if ((surface.size() % 3) != 0)
             {
                 THROW << "Polygon surface must be an array with size divisible by 3";
             }
         }
         auto verticesCount = vertices.size();
-        for (const Value &vi : surface)
+        result.reserve(surface.size());
+        for (uint32 si = surface.begin; si < surface.end; si++)
         {
-            Json::UInt i = vi.asUInt();
+            uint32 i = features.indices[si];
             if (i >= verticesCount)
                 THROW << "Index out of range (polygon surface vertex)";
             result.push_back(vertices[i]);
@@ -43,7 +43,16 @@ GeodataFeatures::GeodataFeatures(vts::MapImpl *map, const std::string &name) : R
 void GeodataFeatures::decode()
 {
     LOG(info2) << "Decoding geodata features <" << name << ">";
-    data = std::make_shared<const std::string>(fetch->reply.content.str());
+    std::string json = fetch->reply.content.str();
+    store = std::make_shared<const GeodataFeatureStore>(stringToJson(json));
+    info.ramMemoryCost = sizeof(*this) + store->memoryUsage();
+    if (keepJson)
+    {
+        info.ramMemoryCost += json.size();
+        data = std::make_shared<const std::string>(std::move(json));
+    }
+    else
+        data.reset();
 
 #ifndef __EMSCRIPTEN__
     if (map->options.debugExtractRawResources)
@@ -54,7 +63,7 @@ void GeodataFeatures::decode()
         if (!boost::filesystem::exists(path))
         {
             boost::filesystem::create_directories(prefix + b);
-            writeLocalFileBuffer(path, Buffer(*data));
+            writeLocalFileBuffer(path, fetch->reply.content);
         }
     }
 #endif
@@ -236,7 +245,7 @@ FetchTask::ResourceType GeodataTile::resourceType() const
     return FetchTask::ResourceType::Undefined;
 }
 
-void GeodataTile::update(const std::shared_ptr<GeodataStylesheet> &s, const std::shared_ptr<const std::string> &f, const std::shared_ptr<const Json::Value> &b, const vec3 ab[2], const TileId &tid)
+void GeodataTile::update(const std::shared_ptr<GeodataStylesheet> &s, const std::shared_ptr<const GeodataFeatureStore> &f, const std::shared_ptr<const Json::Value> &b, const vec3 ab[2], const TileId &tid)
 {
     switch ((Resource::State)state)
     {
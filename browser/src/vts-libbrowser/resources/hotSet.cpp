@@ -0,0 +1,266 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../include/vts-browser/log.hpp"
+
+#include "../resources.hpp"
+#include "../gpuResource.hpp"
+#include "../metaTile.hpp"
+#include "../map.hpp"
+
+#include <optick.h>
+
+#include <algorithm>
+#include <sstream>
+
+namespace vts
+{
+
+namespace
+{
+
+static const char HotSetMagic[] = "vts-hotset 1";
+
+std::string hotSetCacheName(const std::string &mapconfigPath)
+{
+    auto p = mapconfigPath.find("://");
+    return std::string("hotset/") + (p == std::string::npos
+        ? mapconfigPath : mapconfigPath.substr(p + 3));
+}
+
+} // namespace
+
+bool Resources::hotSetPrepare(const Resource &r, HotSetEntry &e)
+{
+    if (r.accessCount == 0 || r.state != Resource::State::ready)
+        return false;
+    if (r.name.compare(0, 5, "data:") == 0)
+        return false;
+    switch (r.resourceType())
+    {
+    case FetchTask::ResourceType::Texture:
+    {
+        // the warm-up creates textures with default parameters only
+        const GpuTexture *t = dynamic_cast<const GpuTexture*>(&r);
+        if (!t || t->filterMode != GpuTextureSpec::FilterMode::Linear
+            || t->wrapMode != GpuTextureSpec::WrapMode::ClampToEdge)
+            return false;
+    } break;
+    case FetchTask::ResourceType::Mesh:
+    case FetchTask::ResourceType::BoundMetaTile:
+        break;
+    default:
+        // other resources depend on the mapconfig to decode
+        return false;
+    }
+    e.type = (uint32)r.resourceType();
+    e.accessCount = r.accessCount;
+    e.memoryCost = r.info.ramMemoryCost + r.info.gpuMemoryCost;
+    return true;
+}
+
+void Resources::hotSetRecord(const std::string &name, const HotSetEntry &e)
+{
+    if (map->options.hotSetSize == 0)
+        return;
+    HotSetEntry &h = hotSet[name];
+    h.type = e.type;
+    h.accessCount += e.accessCount;
+    h.memoryCost = e.memoryCost;
+
+    // limit the memory used by the histogram
+    //   keep exactly the top ranked entries, regardless of ties
+    if (hotSet.size() > map->options.hotSetSize * 8)
+    {
+        typedef decltype(hotSet)::iterator Iterator;
+        std::vector<Iterator> ranks;
+        ranks.reserve(hotSet.size());
+        for (auto it = hotSet.begin(); it != hotSet.end(); it++)
+            ranks.push_back(it);
+        auto nth = ranks.begin() + map->options.hotSetSize * 2;
+        std::nth_element(ranks.begin(), nth, ranks.end(),
+            [](const Iterator &a, const Iterator &b) {
+            return a->second.accessCount > b->second.accessCount;
+        });
+        for (auto it = nth; it != ranks.end(); it++)
+            hotSet.erase(*it);
+    }
+}
+
+void Resources::hotSetSave(bool synchronous)
+{
+    if (map->options.hotSetSize == 0 || map->mapconfigPath.empty())
+        return;
+    OPTICK_EVENT();
+
+    // include resources that are still alive
+    for (const auto &it : resources)
+    {
+        HotSetEntry e;
+        if (hotSetPrepare(*it.second, e))
+        {
+            hotSetRecord(it.first, e);
+            it.second->accessCount = 0; // do not count them again on release
+        }
+    }
+    if (hotSet.empty())
+        return;
+
+    std::vector<std::pair<const std::string *, const HotSetEntry *>> sorted;
+    sorted.reserve(hotSet.size());
+    for (const auto &it : hotSet)
+        sorted.emplace_back(&it.first, &it.second);
+    std::sort(sorted.begin(), sorted.end(), [](
+        const std::pair<const std::string *, const HotSetEntry *> &a,
+        const std::pair<const std::string *, const HotSetEntry *> &b) {
+        return a.second->accessCount > b.second->accessCount;
+    });
+    if (sorted.size() > map->options.hotSetSize)
+        sorted.resize(map->options.hotSetSize);
+
+    std::ostringstream ss;
+    ss << HotSetMagic << "\n";
+    for (const auto &it : sorted)
+    {
+        ss << it.second->type << " " << it.second->accessCount << " "
+            << it.second->memoryCost << " " << *it.first << "\n";
+    }
+
+    CacheData cd;
+    cd.name = hotSetCacheName(map->mapconfigPath);
+    cd.buffer = Buffer(ss.str());
+    cd.expires = 0;
+    if (synchronous)
+        cacheWrite(cd);
+    else
+        queCacheWrite.push(std::move(cd));
+    LOG(info2) << "Saved hot set with " << sorted.size() << " resources";
+}
+
+void Resources::hotSetLoad()
+{
+    hotSet.clear();
+    hotSetWarmup.clear();
+    if (map->options.hotSetSize == 0 || map->mapconfigPath.empty())
+        return;
+    OPTICK_EVENT();
+
+    CacheData cd = cacheRead(hotSetCacheName(map->mapconfigPath));
+    if (cd.name.empty())
+        return;
+    std::istringstream ss(cd.buffer.str());
+    std::string line;
+    if (!std::getline(ss, line) || line != HotSetMagic)
+        return;
+
+    // entries are stored in order of decreasing access count
+    std::vector<std::pair<std::string, HotSetEntry>> entries;
+    while (std::getline(ss, line))
+    {
+        std::istringstream ls(line);
+        HotSetEntry e;
+        std::string name;
+        if (!(ls >> e.type >> e.accessCount >> e.memoryCost))
+            continue;
+        ls >> std::ws;
+        std::getline(ls, name);
+        if (name.empty())
+            continue;
+        // older history has lower weight
+        e.accessCount /= 2;
+        if (e.accessCount > 0)
+            hotSet[name] = e;
+        entries.emplace_back(std::move(name), e);
+    }
+
+    // start loading the resources from the disk cache
+    const uint64 budget = (uint64)map->options.targetResourcesMemoryKB * 1024 / 2;
+    uint64 used = 0;
+    for (const auto &it : entries)
+    {
+        if (hotSetWarmup.size() >= map->options.hotSetSize)
+            break;
+        if (used + it.second.memoryCost > budget)
+            continue;
+        std::shared_ptr<Resource> r;
+        switch ((FetchTask::ResourceType)it.second.type)
+        {
+        case FetchTask::ResourceType::Texture:
+            r = map->getTexture(it.first);
+            break;
+        case FetchTask::ResourceType::Mesh:
+            r = map->getMeshAggregate(it.first);
+            break;
+        case FetchTask::ResourceType::BoundMetaTile:
+            r = map->getBoundMetaTile(it.first);
+            break;
+        default:
+            continue;
+        }
+        if (r->state != Resource::State::initializing)
+            continue;
+        used += it.second.memoryCost;
+        r->accessCount = 0;
+        r->warmup = true;
+        hotSetWarmup.push_back(r);
+    }
+    if (!hotSetWarmup.empty())
+    {
+        LOG(info2) << "Warming up " << hotSetWarmup.size()
+            << " resources (" << (used / 1024) << " KB) from hot set";
+    }
+}
+
+void Resources::hotSetUpdate()
+{
+    if (hotSetWarmup.empty())
+        return;
+    OPTICK_EVENT();
+
+    // everything is rendered, the map keeps whatever it needs
+    if (map->mapconfigReady && map->getMapRenderComplete())
+    {
+        hotSetWarmup.clear();
+        return;
+    }
+
+    // release resources that missed the disk cache
+    //   or that are already used by the map
+    hotSetWarmup.erase(std::remove_if(hotSetWarmup.begin(),
+        hotSetWarmup.end(), [](const std::shared_ptr<Resource> &r) {
+        switch ((Resource::State)r->state)
+        {
+        case Resource::State::errorFatal:
+        case Resource::State::errorRetry:
+        case Resource::State::availFail:
+            return true;
+        default:
+            return !r->warmup;
+        }
+    }), hotSetWarmup.end());
+}
+
+} // namespace vts
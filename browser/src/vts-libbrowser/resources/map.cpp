@@ -64,7 +64,12 @@ std::shared_ptr<T> getMapResource(MapImpl *map, const std::string &name)
 
 void MapImpl::touchResource(const std::shared_ptr<Resource> &resource)
 {
+    if (resource->warmup)
+        resource->warmup = false;
+    if (resource->lastAccessTick == renderTickIndex)
+        return;
     resource->lastAccessTick = renderTickIndex;
+    resource->accessCount++;
 }
 
 Validity MapImpl::getResourceValidity(const std::string &name)
@@ -82,11 +87,12 @@ Validity MapImpl::getResourceValidity(
     {
     case Resource::State::errorFatal:
     case Resource::State::availFail:
-        return Validity::Invalid;
+        // a failed upgrade is reverted by the main thread
+        return resource->upgrading ? Validity::Valid : Validity::Invalid;
     case Resource::State::ready:
         return Validity::Valid;
     default:
-        return Validity::Indeterminate;
+        return resource->upgrading ? Validity::Valid : Validity::Indeterminate;
     }
 }
 
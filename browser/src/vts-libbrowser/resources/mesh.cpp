@@ -25,6 +25,7 @@
  */
 
 #include "../utilities/obj.hpp"
+#include "../utilities/meshOptimize.hpp"
 #include "../gpuResource.hpp"
 #include "../fetchTask.hpp"
 #include "../map.hpp"
@@ -63,10 +64,71 @@ GpuMeshSpec::GpuMeshSpec(const Buffer &buffer) :
     }
 }
 
+namespace
+{
+
+// returns vertex size
+uint32 meshAttributes(GpuMeshSpec &spec, bool internalUv, bool externalUv)
+{
+    uint32 vertexSize = sizeof(vec3f);
+    if (internalUv)
+        vertexSize += sizeof(vec2ui16);
+    if (externalUv)
+        vertexSize += sizeof(vec2ui16);
+
+    uint32 offset = 0;
+
+    { // positions
+        spec.attributes[0].enable = true;
+        spec.attributes[0].components = 3;
+        spec.attributes[0].offset = offset;
+        spec.attributes[0].stride = vertexSize;
+        offset += sizeof(vec3f);
+    }
+
+    if (internalUv)
+    { // internal uv
+        spec.attributes[1].enable = true;
+        spec.attributes[1].type = GpuTypeEnum::UnsignedShort;
+        spec.attributes[1].components = 2;
+        spec.attributes[1].normalized = true;
+        spec.attributes[1].offset = offset;
+        spec.attributes[1].stride = vertexSize;
+        offset += sizeof(vec2ui16);
+    }
+
+    if (externalUv)
+    { // external uv
+        spec.attributes[2].enable = true;
+        spec.attributes[2].type = GpuTypeEnum::UnsignedShort;
+        spec.attributes[2].components = 2;
+        spec.attributes[2].normalized = true;
+        spec.attributes[2].offset = offset;
+        spec.attributes[2].stride = vertexSize;
+        offset += sizeof(vec2ui16);
+    }
+
+    assert(offset == vertexSize);
+    return vertexSize;
+}
+
+} // namespace
+
 GpuMesh::GpuMesh(MapImpl *map, const std::string &name) :
     Resource(map, name)
 {}
 
+GpuMesh::GpuMesh(MapImpl *map, const std::string &name,
+                 GpuMeshSpec &&spec) :
+    Resource(map, name)
+{
+    // this type of mesh is never managed by the resource manager
+    // instead it is always owned by an aggregate mesh
+    state = Resource::State::errorFatal;
+    faces = spec.indicesCount / 3;
+    decodeData = std::make_shared<GpuMeshSpec>(std::move(spec));
+}
+
 GpuMesh::GpuMesh(MapImpl *map, const std::string &name,
                  const vtslibs::vts::SubMesh &m) :
     Resource(map, name)
@@ -80,51 +142,12 @@ GpuMesh::GpuMesh(MapImpl *map, const std::string &name,
     assert(m.facesTc.size() == m.faces.size() || m.facesTc.empty());
     assert(m.etc.size() == m.vertices.size() || m.etc.empty());
 
-    uint32 vertexSize = sizeof(vec3f);
-    if (m.tc.size())
-        vertexSize += sizeof(vec2ui16);
-    if (m.etc.size())
-        vertexSize += sizeof(vec2ui16);
-
     GpuMeshSpec spec;
 
 #if 1 // indexed mesh
 
-    { // vertex attributes
-        uint32 offset = 0;
-
-        { // positions
-            spec.attributes[0].enable = true;
-            spec.attributes[0].components = 3;
-            spec.attributes[0].offset = offset;
-            spec.attributes[0].stride = vertexSize;
-            offset += sizeof(vec3f);
-        }
-
-        if (!m.tc.empty())
-        { // internal uv
-            spec.attributes[1].enable = true;
-            spec.attributes[1].type = GpuTypeEnum::UnsignedShort;
-            spec.attributes[1].components = 2;
-            spec.attributes[1].normalized = true;
-            spec.attributes[1].offset = offset;
-            spec.attributes[1].stride = vertexSize;
-            offset += sizeof(vec2ui16);
-        }
-
-        if (!m.etc.empty())
-        { // external uv
-            spec.attributes[2].enable = true;
-            spec.attributes[2].type = GpuTypeEnum::UnsignedShort;
-            spec.attributes[2].components = 2;
-            spec.attributes[2].normalized = true;
-            spec.attributes[2].offset = offset;
-            spec.attributes[2].stride = vertexSize;
-            offset += sizeof(vec2ui16);
-        }
-
-        assert(offset == vertexSize);
-    }
+    const uint32 vertexSize = meshAttributes(spec,
+        !m.tc.empty(), !m.etc.empty());
 
     if (m.tc.empty())
     {
@@ -217,6 +240,11 @@ GpuMesh::GpuMesh(MapImpl *map, const std::string &name,
 
 #else // indexed
 
+    uint32 vertexSize = sizeof(vec3f);
+    if (m.tc.size())
+        vertexSize += sizeof(vec2ui16);
+    if (m.etc.size())
+        vertexSize += sizeof(vec2ui16);
     spec.verticesCount = m.faces.size() * 3;
     spec.vertices.allocate(spec.verticesCount * vertexSize);
     uint32 offset = 0;
@@ -319,10 +347,8 @@ FetchTask::ResourceType GpuMesh::resourceType() const
 namespace
 {
 
-const mat4 findNormToPhys(const math::Extents3 &extents)
+const mat4 findNormToPhys(const vec3 &l, const vec3 &u)
 {
-    vec3 u = vecFromUblas<vec3>(extents.ur);
-    vec3 l = vecFromUblas<vec3>(extents.ll);
     vec3 d = (u - l) * 0.5;
     vec3 c = (u + l) * 0.5;
     mat4 sc = scaleMatrix(d(0), d(1), d(2));
@@ -330,6 +356,271 @@ const mat4 findNormToPhys(const math::Extents3 &extents)
     return tr * sc;
 }
 
+const mat4 findNormToPhys(const math::Extents3 &extents)
+{
+    return findNormToPhys(vecFromUblas<vec3>(extents.ll),
+                          vecFromUblas<vec3>(extents.ur));
+}
+
+struct DecodedSubMesh
+{
+    GpuMeshSpec spec;
+    vec3 ll, ur;
+    uint32 textureLayer = 0;
+    uint32 surfaceReference = 0;
+};
+
+class MeshReader
+{
+public:
+    MeshReader(const Buffer &in) : p(in.data()), e(in.dataEnd())
+    {}
+
+    template<class T> T read()
+    {
+        T v = T();
+        if (sizeof(T) > (std::size_t)(e - p))
+        {
+            ok = false;
+            return v;
+        }
+        memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return v;
+    }
+
+    // returns pointer to the skipped data
+    const char *skip(std::size_t size)
+    {
+        const char *r = p;
+        if (size > (std::size_t)(e - p))
+        {
+            ok = false;
+            return r;
+        }
+        p += size;
+        return r;
+    }
+
+    const char *p, *e;
+    bool ok = true;
+};
+
+uint16 readU16(const char *p)
+{
+    uint16 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// same arithmetic as the vtslibs loader followed by the normalization
+float normalizedPosition(uint16 q, double l, double u)
+{
+    const double s = u - l;
+    const double v = l + (q * s) / 65535.0;
+    const double d = s * 0.5;
+    if (d == 0)
+        return 0;
+    return (v - (u + l) * 0.5) / d;
+}
+
+// same rounding as conversion of the vtslibs texture coordinates
+uint16 uvCoordinate(uint16 q)
+{
+    float v = (float)(q / 65535.0) * 65535.0f;
+    v = std::min(std::max(v, 0.0f), 65535.0f);
+    return (uint16)v;
+}
+
+// streaming parser of the vts mesh binary format
+//   reads the quantized data directly into the interleaved gpu buffers
+// covers the legacy versions 1 and 2 only
+// returns false for other versions or features it does not handle
+//   (the vtslibs loader is used instead)
+bool decodeMeshDirect(const Buffer &in, std::vector<DecodedSubMesh> &out)
+{
+    enum : uint8
+    {
+        InternalTexture = 0x1,
+        ExternalTexture = 0x2,
+        TextureMode = 0x8,
+    };
+
+    MeshReader r(in);
+    if (r.read<char>() != 'M' || r.read<char>() != 'E')
+        return false;
+    const uint16 version = r.read<uint16>();
+    if (version < 1 || version > 2)
+        return false;
+    r.read<double>(); // mean undulation, not used by the browser
+    const uint16 count = r.read<uint16>();
+    out.resize(count);
+
+    for (DecodedSubMesh &sm : out)
+    {
+        const uint8 flags = r.read<uint8>();
+        if (flags & ~(InternalTexture | ExternalTexture | TextureMode))
+            return false;
+        const bool internal = flags & InternalTexture;
+        const bool external = flags & ExternalTexture;
+        if (version >= 2)
+            sm.surfaceReference = r.read<uint8>();
+        const uint16 textureLayer = r.read<uint16>();
+        if (flags & TextureMode)
+            sm.textureLayer = textureLayer;
+        for (uint32 i = 0; i < 3; i++)
+            sm.ll[i] = r.read<double>();
+        for (uint32 i = 0; i < 3; i++)
+            sm.ur[i] = r.read<double>();
+
+        // locate the blocks of data, they are read in place
+        const uint32 vertexStride = external ? 10 : 6;
+        const uint32 verticesCount = r.read<uint16>();
+        const char *vertices = r.skip(verticesCount * vertexStride);
+        uint32 tcCount = 0;
+        const char *tcs = nullptr;
+        if (internal)
+        {
+            tcCount = r.read<uint16>();
+            tcs = r.skip(tcCount * 4);
+        }
+        const uint32 faceStride = internal ? 12 : 6;
+        const uint32 facesCount = r.read<uint16>();
+        const char *faces = r.skip(facesCount * faceStride);
+        if (!r.ok)
+            return false;
+
+        GpuMeshSpec &spec = sm.spec;
+        const uint32 vertexSize = meshAttributes(spec, internal, external);
+        spec.verticesCount = internal ? tcCount : verticesCount;
+        spec.vertices.allocate(spec.verticesCount * vertexSize);
+        spec.indicesCount = facesCount * 3;
+        spec.indices.allocate(spec.indicesCount * sizeof(uint16));
+
+        // vertices not referenced by any face are left zeroed
+        if (internal)
+            memset(spec.vertices.data(), 0, spec.vertices.size());
+
+        const auto &writeVertex = [&](uint32 vi, uint32 oi) {
+            char *o = spec.vertices.data() + oi * vertexSize;
+            const char *v = vertices + vi * vertexStride;
+            float *pos = (float*)o;
+            for (uint32 i = 0; i < 3; i++)
+                pos[i] = normalizedPosition(readU16(v + i * 2),
+                                            sm.ll[i], sm.ur[i]);
+            if (external)
+            {
+                uint16 *uv = (uint16*)(o + spec.attributes[2].offset);
+                uv[0] = uvCoordinate(readU16(v + 6));
+                uv[1] = uvCoordinate(readU16(v + 8));
+            }
+        };
+
+        uint16 *io = (uint16*)spec.indices.data();
+        if (!internal)
+        {
+            // external control
+            for (uint32 i = 0; i < verticesCount; i++)
+                writeVertex(i, i);
+            for (uint32 i = 0; i < spec.indicesCount; i++)
+            {
+                const uint16 vi = readU16(faces + i * 2);
+                if (vi >= verticesCount)
+                    return false;
+                *io++ = vi;
+            }
+        }
+        else
+        {
+            // internal control
+            for (uint32 fi = 0; fi < facesCount; fi++)
+            {
+                const char *f = faces + fi * faceStride;
+                for (uint32 j = 0; j < 3; j++)
+                {
+                    const uint16 vi = readU16(f + j * 2);
+                    const uint16 ti = readU16(f + 6 + j * 2);
+                    if (vi >= verticesCount || ti >= tcCount)
+                        return false;
+                    writeVertex(vi, ti);
+                    uint16 *uv = (uint16*)(spec.vertices.data()
+                        + ti * vertexSize + spec.attributes[1].offset);
+                    uv[0] = uvCoordinate(readU16(tcs + ti * 4));
+                    uv[1] = uvCoordinate(readU16(tcs + ti * 4 + 2));
+                    *io++ = ti;
+                }
+            }
+        }
+        assert((char*)io == spec.indices.dataEnd());
+    }
+
+    // the whole buffer must be consumed
+    return r.ok && r.p == r.e;
+}
+
+void optimizeMeshPart(MapImpl *map, GpuMeshSpec &spec, MeshPart &part)
+{
+    if (map->options.meshCacheOptimization)
+        optimizeMeshCache(spec);
+    mat4 dequantize;
+    if (map->options.meshQuantization
+        && quantizeMeshPositions(spec, dequantize))
+        part.normToPhys = part.normToPhys * dequantize;
+}
+
+// compare the direct parser with the vtslibs loader
+bool validateMeshDirect(const std::vector<DecodedSubMesh> &direct,
+    const vtslibs::vts::NormalizedSubMesh::list &meshes,
+    const std::vector<std::shared_ptr<GpuMesh>> &reference)
+{
+    if (direct.size() != meshes.size())
+        return false;
+    for (uint32 mi = 0, me = direct.size(); mi != me; mi++)
+    {
+        const GpuMeshSpec &a = direct[mi].spec;
+        const GpuMeshSpec &b = *std::static_pointer_cast<GpuMeshSpec>(
+            reference[mi]->decodeData);
+        const auto &m = meshes[mi];
+        if (a.verticesCount != b.verticesCount
+            || a.indicesCount != b.indicesCount
+            || a.vertices.size() != b.vertices.size()
+            || a.indices.size() != b.indices.size()
+            || memcmp(a.indices.data(), b.indices.data(), a.indices.size())
+            || direct[mi].textureLayer != (m.submesh.textureLayer
+                ? *m.submesh.textureLayer : 0)
+            || direct[mi].surfaceReference != m.submesh.surfaceReference)
+            return false;
+        for (uint32 i = 1; i < 3; i++)
+        {
+            if (a.attributes[i].enable != b.attributes[i].enable)
+                return false;
+        }
+
+        // compare positions in physical space,
+        //   the normalization extents may differ
+        const mat4 ma = findNormToPhys(direct[mi].ll, direct[mi].ur);
+        const mat4 mb = findNormToPhys(m.extents);
+        const uint32 stride = a.attributes[0].stride;
+        const double tolerance = (direct[mi].ur - direct[mi].ll)
+            .cwiseAbs().maxCoeff() * 1e-5 + 1e-9;
+        for (uint32 i = 0; i < a.verticesCount; i++)
+        {
+            const char *va = a.vertices.data() + i * stride;
+            const char *vb = b.vertices.data() + i * stride;
+            const vec3 pa = vec4to3(vec4(ma * vec3to4(
+                vec3f(*(const vec3f*)va).cast<double>(), 1)));
+            const vec3 pb = vec4to3(vec4(mb * vec3to4(
+                vec3f(*(const vec3f*)vb).cast<double>(), 1)));
+            if ((pa - pb).norm() > tolerance)
+                return false;
+            if (memcmp(va + sizeof(vec3f), vb + sizeof(vec3f),
+                       stride - sizeof(vec3f)))
+                return false;
+        }
+    }
+    return true;
+}
+
 } // namespace
 
 MeshAggregate::MeshAggregate(MapImpl *map, const std::string &name) :
@@ -341,12 +632,41 @@ void MeshAggregate::decode()
     LOG(info2) << "Decoding (aggregated) mesh <" << name << ">";
     OPTICK_EVENT("decode aggregated mesh");
 
+    submeshes.clear();
+
+    // the extraction needs the vtslibs submeshes
+    std::vector<DecodedSubMesh> direct;
+    const bool directOk = !map->options.debugExtractRawResources
+        && decodeMeshDirect(fetch->reply.content, direct);
+    if (directOk && !map->options.debugValidateMeshParser)
+    {
+        submeshes.reserve(direct.size());
+        for (uint32 mi = 0, me = direct.size(); mi != me; mi++)
+        {
+            DecodedSubMesh &d = direct[mi];
+            std::stringstream ss;
+            ss << name << "#" << mi;
+            MeshPart part;
+            part.normToPhys = findNormToPhys(d.ll, d.ur)
+                    * scaleMatrix(map->options.renderTilesScale);
+            part.internalUv = d.spec.attributes[1].enable;
+            part.externalUv = d.spec.attributes[2].enable;
+            part.textureLayer = d.textureLayer;
+            part.surfaceReference = d.surfaceReference;
+            optimizeMeshPart(map, d.spec, part);
+            part.renderable = std::make_shared<GpuMesh>(map, ss.str(),
+                std::move(d.spec));
+            submeshes.push_back(part);
+        }
+        return;
+    }
+
     detail::BufferStream w(fetch->reply.content);
     vtslibs::vts::NormalizedSubMesh::list meshes = vtslibs::vts::
             loadMeshProperNormalized(w, name);
 
-    submeshes.clear();
     submeshes.reserve(meshes.size());
+    std::vector<std::shared_ptr<GpuMesh>> reference;
 
     for (uint32 mi = 0, me = meshes.size(); mi != me; mi++)
     {
@@ -356,6 +676,7 @@ void MeshAggregate::decode()
         ss << name << "#" << mi;
         std::shared_ptr<GpuMesh> gm
             = std::make_shared<GpuMesh>(map, ss.str(), m);
+        reference.push_back(gm);
 
         const auto &spec = *std::static_pointer_cast
                 <GpuMeshSpec>(gm->decodeData);
@@ -408,6 +729,23 @@ void MeshAggregate::decode()
         }
 #endif // emscripten
     }
+
+    if (directOk)
+    {
+        if (validateMeshDirect(direct, meshes, reference))
+            LOG(info1) << "Mesh parser validated <" << name << ">";
+        else
+            LOG(warn2) << "Mesh parser mismatch <" << name << ">";
+    }
+    else if (map->options.debugValidateMeshParser
+        && !map->options.debugExtractRawResources)
+        LOG(info2) << "Mesh parser fallback <" << name << ">";
+
+    for (uint32 mi = 0, me = submeshes.size(); mi != me; mi++)
+    {
+        optimizeMeshPart(map, *std::static_pointer_cast<GpuMeshSpec>(
+            reference[mi]->decodeData), submeshes[mi]);
+    }
 }
 
 void MeshAggregate::upload()
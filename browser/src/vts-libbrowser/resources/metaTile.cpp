@@ -32,6 +32,9 @@
 
 #include <dbglog/dbglog.hpp>
 
+#include <chrono>
+#include <map>
+
 #include <optick.h>
 
 namespace vts
@@ -53,7 +56,7 @@ vec3 lowerUpperCombine(uint32 i)
 
 } // namespace
 
-MetaNode::MetaNode() :
+MetaNodeData::MetaNodeData() :
     diskNormalPhys(nan3()),
     diskHeightsPhys(nan2()),
     diskHalfAngle(nan1()),
@@ -64,10 +67,124 @@ MetaNode::MetaNode() :
     aabbPhys[1] = inf3();
 }
 
-vec3 MetaNode::cornersPhys(uint32 index) const
+namespace
+{
+
+// float offsets that do not shrink the box
+vec3f offsetDown(const vec3 &v)
+{
+    vec3f r = v.cast<float>();
+    for (uint32 i = 0; i < 3; i++)
+        if (r[i] > v[i])
+            r[i] = std::nextafter(r[i], -inf1());
+    return r;
+}
+
+vec3f offsetUp(const vec3 &v)
+{
+    vec3f r = v.cast<float>();
+    for (uint32 i = 0; i < 3; i++)
+        if (r[i] < v[i])
+            r[i] = std::nextafter(r[i], inf1());
+    return r;
+}
+
+} // namespace
+
+MetaNode::MetaNode() : MetaNode(MetaNodeData())
+{}
+
+MetaNode::MetaNode(const MetaNodeData &d) :
+    tileId(d.tileId),
+    localId(d.localId),
+    extents(d.extents),
+    origin(0, 0, 0),
+    surrogateNavValue(nan1()),
+    diskAngle(d.diskHalfAngle),
+    texel(d.texelSize),
+    flags(0)
+{
+    // the aabb center is the origin of everything else
+    if (d.aabbPhys[1][0] != inf1())
+    {
+        flags |= HasAabb;
+        origin = (d.aabbPhys[0] + d.aabbPhys[1]) * 0.5;
+        aabb[0] = offsetDown(d.aabbPhys[0] - origin);
+        aabb[1] = offsetUp(d.aabbPhys[1] - origin);
+    }
+    if (d.obb)
+    {
+        flags |= HasObb;
+        obbRot = d.obb->rotInv.block<3, 3>(0, 0).cast<float>();
+        obbCenter = (vec3(d.obb->rotInv.block<3, 1>(0, 3)) - origin).cast<float>();
+        obbPoints[0] = offsetDown(d.obb->points[0]);
+        obbPoints[1] = offsetUp(d.obb->points[1]);
+    }
+    if (d.surrogatePhys)
+    {
+        flags |= HasSurrogate;
+        surrogate = (*d.surrogatePhys - origin).cast<float>();
+        surrogateNavValue = d.surrogateNav ? *d.surrogateNav : nan1();
+    }
+    diskNormal = d.diskNormalPhys.cast<float>();
+    const double l = origin.norm();
+    diskHeights[0] = d.diskHeightsPhys[0] - l;
+    diskHeights[1] = d.diskHeightsPhys[1] - l;
+}
+
+vec3 MetaNode::aabbPhys(uint32 index) const
+{
+    assert(index < 2);
+    if (!(flags & HasAabb))
+        return index ? inf3() : vec3(-inf3());
+    return origin + aabb[index].cast<double>();
+}
+
+std::array<vec3, 8> MetaNode::cornersPhys() const
 {
-    assert(index < 8);
-    return lowerUpperCombine(index).cwiseProduct(aabbPhys[1] - aabbPhys[0]) + aabbPhys[0];
+    const vec3 l = aabbPhys(0);
+    const vec3 d = aabbPhys(1) - l;
+    std::array<vec3, 8> res;
+    for (uint32 i = 0; i < 8; i++)
+        res[i] = lowerUpperCombine(i).cwiseProduct(d) + l;
+    return res;
+}
+
+bool MetaNode::obb(Obb &o) const
+{
+    if (!(flags & HasObb))
+        return false;
+    o.rotInv = identityMatrix4();
+    o.rotInv.block<3, 3>(0, 0) = obbRot.cast<double>();
+    o.rotInv.block<3, 1>(0, 3) = origin + obbCenter.cast<double>();
+    o.points[0] = obbPoints[0].cast<double>();
+    o.points[1] = obbPoints[1].cast<double>();
+    return true;
+}
+
+boost::optional<vec3> MetaNode::surrogatePhys() const
+{
+    if (!(flags & HasSurrogate))
+        return {};
+    return vec3(origin + surrogate.cast<double>());
+}
+
+boost::optional<float> MetaNode::surrogateNav() const
+{
+    if (!(flags & HasSurrogate) || std::isnan(surrogateNavValue))
+        return {};
+    return surrogateNavValue;
+}
+
+vec3 MetaNode::diskNormalPhys() const
+{
+    return diskNormal.cast<double>();
+}
+
+vec2 MetaNode::diskHeightsPhys() const
+{
+    const double l = origin.norm();
+    return vec2(diskHeights[0] + l, diskHeights[1] + l);
 }
 
 MetaTile::MetaTile(vts::MapImpl *map, const std::string &name) : Resource(map, name), vtslibs::vts::MetaTile(vtslibs::vts::TileId(), 0)
@@ -88,7 +205,7 @@ Extents2 subExtents(const Extents2 &parentExtents, const TileId& parentId, const
         parentExtents.ur(1) - lid.y * ts.height);
 }
 
-void generateMetaNodeInit(MetaNode &node, std::string &srs, const std::shared_ptr<Mapconfig> &m, const vtslibs::vts::TileId &id)
+void generateMetaNodeInit(MetaNodeData &node, std::string &srs, const std::shared_ptr<Mapconfig> &m, const vtslibs::vts::TileId &id)
 {
     TileId t = id;
     while (true)
@@ -112,7 +229,7 @@ void generateMetaNodeInit(MetaNode &node, std::string &srs, const std::shared_pt
     assert(node.tileId == id);
 }
 
-void generateMetaNodeBoxes(MetaNode &node, const std::array<vec3, 8> &cornersPhys)
+void generateMetaNodeBoxes(MetaNodeData &node, const std::array<vec3, 8> &cornersPhys)
 {
     // obb
     if (!std::isnan(cornersPhys[0][0]) && node.tileId.lod > 4)
@@ -127,7 +244,7 @@ void generateMetaNodeBoxes(MetaNode &node, const std::array<vec3, 8> &cornersPhy
         vec3 u = cp[4] + cp[5] + cp[6] + cp[7] - cp[0] - cp[1] - cp[2] - cp[3];
         mat4 t = lookAt(center, center + f, u);
 
-        MetaNode::Obb obb;
+        MetaNodeData::Obb obb;
         obb.rotInv = t.inverse();
         obb.points[0] = inf3();
         obb.points[1] = -inf3();
@@ -154,7 +271,7 @@ void generateMetaNodeBoxes(MetaNode &node, const std::array<vec3, 8> &cornersPhy
     }
 }
 
-void generateMetaNodeApplyDisplaySize(MetaNode &node, int displaySize)
+void generateMetaNodeApplyDisplaySize(MetaNodeData &node, int displaySize)
 {
     if (node.aabbPhys[1][0] != inf1())
     {
@@ -164,29 +281,73 @@ void generateMetaNodeApplyDisplaySize(MetaNode &node, int displaySize)
     }
 }
 
-MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m, const std::shared_ptr<CoordManip> &cnv, const vtslibs::vts::TileId &id, const vtslibs::vts::MetaNode &meta)
+namespace
+{
+
+// node generation is split in two phases,
+//   so that the coordinates of many nodes are converted at once
+struct MetaNodeBuild
 {
-    MetaNode node;
+    MetaNodeData node;
     std::string srs;
-    generateMetaNodeInit(node, srs, m, id);
+    uint32 physOffset = 0;
+    uint32 navOffset = 0;
+    bool corners = false;
+    bool disks = false;
+    bool surrogate = false;
+};
+
+// collect points that need conversion from the node srs
+void generateMetaNodePrepare(MetaNodeBuild &b, const std::shared_ptr<Mapconfig> &m, const vtslibs::vts::TileId &id, const vtslibs::vts::MetaNode &meta, std::vector<vec3> &phys, std::vector<vec3> &nav)
+{
+    const MetaNodeData &node = b.node;
+    b.physOffset = phys.size();
+    b.navOffset = nav.size();
+    const vec2 fl = vecFromUblas<vec2>(node.extents.ll);
+    const vec2 fu = vecFromUblas<vec2>(node.extents.ur);
 
     // corners
-    std::array<vec3, 8> cornersPhys; // oriented trapezoid bounding box corners
-    if (!vtslibs::vts::empty(meta.geomExtents) && !srs.empty())
+    if (!vtslibs::vts::empty(meta.geomExtents) && !b.srs.empty())
     {
-        const bool projected = m->navigationSrsType() == vtslibs::registry::Srs::Type::projected;
-
-        vec2 fl = vecFromUblas<vec2>(node.extents.ll);
-        vec2 fu = vecFromUblas<vec2>(node.extents.ur);
+        b.corners = true;
         vec3 el = vec2to3(fl, double(meta.geomExtents.z.min));
         vec3 eu = vec2to3(fu, double(meta.geomExtents.z.min));
         vec3 ed = eu - el;
         for (uint32 i = 0; i < 4; i++)
+            phys.push_back(lowerUpperCombine(i).cwiseProduct(ed) + el);
+
+        // disks
+        const bool projected = m->navigationSrsType() == vtslibs::registry::Srs::Type::projected;
+        if (id.lod > 4 && !projected)
         {
-            vec3 f = lowerUpperCombine(i).cwiseProduct(ed) + el;
-            f = cnv->convert(f, srs, Srs::Physical);
-            cornersPhys[i] = f;
+            b.disks = true;
+            phys.push_back(vec2to3(vec2((fu + fl) * 0.5), double(meta.geomExtents.z.min)));
+            phys.push_back(vec2to3(fu, double(meta.geomExtents.z.min)));
         }
+    }
+
+    // surrogate
+    if (vtslibs::vts::GeomExtents::validSurrogate(meta.geomExtents.surrogate))
+    {
+        b.surrogate = true;
+        vec3 sds = vec2to3(vec2((fl + fu) * 0.5), double(meta.geomExtents.surrogate));
+        phys.push_back(sds);
+        nav.push_back(sds);
+    }
+}
+
+// finish the node from the converted points
+void generateMetaNodeFinish(MetaNodeBuild &b, const std::shared_ptr<Mapconfig> &m, const vtslibs::vts::TileId &id, const vtslibs::vts::MetaNode &meta, const vec3 *phys, const vec3 *nav)
+{
+    MetaNodeData &node = b.node;
+
+    // corners
+    std::array<vec3, 8> cornersPhys; // oriented trapezoid bounding box corners
+    if (b.corners)
+    {
+        const bool projected = m->navigationSrsType() == vtslibs::registry::Srs::Type::projected;
+        for (uint32 i = 0; i < 4; i++)
+            cornersPhys[i] = *phys++;
         for (uint32 i = 4; i < 8; i++)
         {
             vec3 bottom = cornersPhys[i - 4];
@@ -195,16 +356,13 @@ MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m, const std::shared
         }
 
         // disks
-        if (id.lod > 4 && !projected)
+        if (b.disks)
         {
-            vec2 sds2 = vec2((fu + fl) * 0.5);
-            vec3 sds = vec2to3(sds2, double(meta.geomExtents.z.min));
-            vec3 vn1 = cnv->convert(sds, srs, Srs::Physical);
+            vec3 vn1 = *phys++;
             node.diskNormalPhys = vn1.normalized();
             node.diskHeightsPhys[0] = vn1.norm();
             node.diskHeightsPhys[1] = node.diskHeightsPhys[0] + double(meta.geomExtents.z.max) - double(meta.geomExtents.z.min);
-            sds = vec2to3(fu, double(meta.geomExtents.z.min));
-            vec3 vc = cnv->convert(sds, srs, Srs::Physical);
+            vec3 vc = *phys++;
             node.diskHalfAngle = std::acos(dot(node.diskNormalPhys, vc.normalized()));
         }
     }
@@ -218,13 +376,10 @@ MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m, const std::shared
     generateMetaNodeBoxes(node, cornersPhys);
 
     // surrogate
-    if (vtslibs::vts::GeomExtents::validSurrogate(meta.geomExtents.surrogate))
+    if (b.surrogate)
     {
-        vec2 fl = vecFromUblas<vec2>(node.extents.ll);
-        vec2 fu = vecFromUblas<vec2>(node.extents.ur);
-        vec3 sds = vec2to3(vec2((fl + fu) * 0.5), double(meta.geomExtents.surrogate));
-        node.surrogatePhys = cnv->convert(sds, srs, Srs::Physical);
-        node.surrogateNav = cnv->convert(sds, srs, Srs::Navigation)[2];
+        node.surrogatePhys = *phys++;
+        node.surrogateNav = (*nav++)[2];
     }
 
     // texelSize
@@ -237,13 +392,25 @@ MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m, const std::shared
     {
         generateMetaNodeApplyDisplaySize(node, meta.displaySize);
     }
+}
+
+} // namespace
 
-    return node;
+MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m, const std::shared_ptr<CoordManip> &cnv, const vtslibs::vts::TileId &id, const vtslibs::vts::MetaNode &meta)
+{
+    MetaNodeBuild b;
+    generateMetaNodeInit(b.node, b.srs, m, id);
+    std::vector<vec3> phys, nav;
+    generateMetaNodePrepare(b, m, id, meta, phys, nav);
+    cnv->convert(phys.data(), phys.data(), phys.size(), b.srs, Srs::Physical);
+    cnv->convert(nav.data(), nav.data(), nav.size(), b.srs, Srs::Navigation);
+    generateMetaNodeFinish(b, m, id, meta, phys.data(), nav.data());
+    return MetaNode(b.node);
 }
 
 MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m, const std::shared_ptr<CoordManip> &cnv, const vtslibs::vts::TileId &id, const vtslibs::registry::FreeLayer::Geodata &geo)
 {
-    MetaNode node;
+    MetaNodeData node;
     std::string srs;
     generateMetaNodeInit(node, srs, m, id);
 
@@ -277,7 +444,7 @@ MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m, const std::shared
     generateMetaNodeBoxes(node, cornersPhys);
     generateMetaNodeApplyDisplaySize(node, geo.displaySize);
 
-    return node;
+    return MetaNode(node);
 }
 
 void MetaTile::decode()
@@ -296,18 +463,98 @@ void MetaTile::decode()
         *(vtslibs::vts::MetaTile*)this = vtslibs::vts::loadMetaTile(w, m->referenceFrame.metaBinaryOrder, name);
     }
 
-    // precompute metanodes
-    metas.resize(size_ * size_);
-    vtslibs::vts::MetaTile::for_each([&](const vtslibs::vts::TileId &id, vtslibs::vts::MetaNode &node)
+    // metanodes are generated on demand
+    vtslibs::vts::MetaTile::for_each([&](const vtslibs::vts::TileId &, vtslibs::vts::MetaNode &node)
         {
-            if (node.flags() == 0)
-                return;
             node.displaySize = 1024; // forced override
-            metas[(id.y - origin_.y) * size_ + id.x - origin_.x] = generateMetaNode(m, m->convertorData, id, node);
         });
+    // the nodes handed out before are owned by the traversal
+    metas.clear();
+    metas.resize(size_ * size_);
 
     info.ramMemoryCost += sizeof(*this);
-    info.ramMemoryCost += size_ * size_ * (sizeof(vtslibs::vts::MetaNode) + sizeof(MetaNode));
+    info.ramMemoryCost += size_ * size_ * (sizeof(vtslibs::vts::MetaNode) + sizeof(std::shared_ptr<const MetaNode>));
+}
+
+bool MetaTile::generateNodes(const TileId &tileId)
+{
+    OPTICK_EVENT("generate metanodes");
+    std::shared_ptr<Mapconfig> m = mapconfig.lock();
+    if (!m)
+        return false; // the metatile is no longer used
+
+    // the traversal usually asks for all four siblings,
+    //   their coordinates are converted in one batch
+    const auto start = std::chrono::steady_clock::now();
+    struct Pending
+    {
+        MetaNodeBuild build;
+        vtslibs::vts::TileId id;
+        const vtslibs::vts::MetaNode *meta;
+        uint32 index;
+    };
+    struct Points
+    {
+        std::vector<vec3> phys, nav;
+    };
+    std::array<Pending, 4> pending;
+    uint32 pendingCount = 0;
+    std::map<std::string, Points> points; // by srs
+    const uint32 x0 = tileId.x & ~1u;
+    const uint32 y0 = tileId.y & ~1u;
+    for (uint32 i = 0; i < 4; i++)
+    {
+        const vtslibs::vts::TileId id(tileId.lod, x0 + i % 2, y0 + i / 2);
+        if (id.x < origin_.x || id.y < origin_.y || id.x >= origin_.x + size_ || id.y >= origin_.y + size_)
+            continue;
+        const uint32 idx = (id.y - origin_.y) * size_ + id.x - origin_.x;
+        if (metas[idx])
+            continue;
+        const vtslibs::vts::MetaNode &node = get(id);
+        if (node.flags() == 0)
+            continue;
+        Pending &p = pending[pendingCount++];
+        p.id = id;
+        p.meta = &node;
+        p.index = idx;
+        generateMetaNodeInit(p.build.node, p.build.srs, m, id);
+        Points &pts = points[p.build.srs];
+        generateMetaNodePrepare(p.build, m, id, node, pts.phys, pts.nav);
+    }
+    try
+    {
+        for (auto &it : points)
+        {
+            Points &pts = it.second;
+            map->convertor->convert(pts.phys.data(), pts.phys.data(), pts.phys.size(), it.first, Srs::Physical);
+            map->convertor->convert(pts.nav.data(), pts.nav.data(), pts.nav.size(), it.first, Srs::Navigation);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        LOG(err3) << "Failed generating metanodes in <" << name << ">, exception <" << e.what() << ">";
+        map->statistics.resourcesFailed++;
+        state = Resource::State::errorFatal;
+        return false;
+    }
+    for (uint32 i = 0; i < pendingCount; i++)
+    {
+        Pending &p = pending[i];
+        const Points &pts = points[p.build.srs];
+        generateMetaNodeFinish(p.build, m, p.id, *p.meta, pts.phys.data() + p.build.physOffset, pts.nav.data() + p.build.navOffset);
+        metas[p.index] = std::make_shared<const MetaNode>(p.build.node);
+    }
+
+    // measure the throughput
+    if (pendingCount > 0)
+    {
+        const double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const double rate = pendingCount / std::max(duration, 1e-6);
+        uint32 &s = map->statistics.metaNodesPerSecond;
+        s = s == 0 ? (uint32)rate : (uint32)(s * 0.9 + rate * 0.1);
+        map->statistics.metaNodesGenerated += pendingCount;
+    }
+    return true;
 }
 
 FetchTask::ResourceType MetaTile::resourceType() const
@@ -318,9 +565,10 @@ FetchTask::ResourceType MetaTile::resourceType() const
 std::shared_ptr<const MetaNode> MetaTile::getNode(const TileId &tileId)
 {
     const auto idx = index(tileId, false);
-    const boost::optional<MetaNode> &mn = metas[idx];
-    assert(mn);
-    return std::shared_ptr<const MetaNode>(shared_from_this(), mn.get_ptr());
+    if (!metas[idx] && !generateNodes(tileId))
+        return {};
+    assert(metas[idx]);
+    return metas[idx];
 }
 
 } // namespace vts
@@ -37,6 +37,14 @@ FetchTaskImpl::FetchTaskImpl(const std::shared_ptr<Resource> &resource) : FetchT
     reply.expires = -1;
 }
 
+float FetchTaskImpl::priority() const
+{
+    std::shared_ptr<Resource> r = resource.lock();
+    if (r)
+        return r->priority;
+    return 0;
+}
+
 bool FetchTaskImpl::performAvailTest() const
 {
     if (!availTest)
@@ -74,6 +82,8 @@ Resource::~Resource()
         assert(!map->resources->queUpload.stop);
         map->resources->queUpload.push(UploadData(info.userData, 0));
     }
+    if (upgradeInfo.userData)
+        map->resources->queUpload.push(UploadData(upgradeInfo.userData, 0));
     map->resources->existing--;
 }
 
@@ -97,6 +107,33 @@ bool Resource::allowDiskCache(FetchTask::ResourceType type)
     }
 }
 
+bool Resource::allowSnapshot() const
+{
+    if (!map->createOptions.startupSnapshot)
+        return false;
+    return snapshotTile || !allowDiskCache();
+}
+
+bool Resource::allowRamCache() const
+{
+    if (map->options.ramCacheMemoryKB == 0)
+        return false;
+    switch (resourceType())
+    {
+    case FetchTask::ResourceType::MetaTile:
+    case FetchTask::ResourceType::Mesh:
+    case FetchTask::ResourceType::Texture:
+    case FetchTask::ResourceType::NavTile:
+        break;
+    default:
+        return false;
+    }
+    // local resources are cheap to read again
+    return name.find("://") != std::string::npos
+        && name.compare(0, 11, "internal://") != 0
+        && name.compare(0, 13, "atmdensity://") != 0;
+}
+
 void Resource::updatePriority(float p)
 {
     if (!std::isnan(priority))
@@ -129,7 +166,7 @@ void Resource::forceRedownload()
 
 Resource::operator bool() const
 {
-    return state == Resource::State::ready;
+    return state == Resource::State::ready || upgrading;
 }
 
 std::shared_ptr<void> Resource::getUserData() const
@@ -31,6 +31,8 @@
 #include "../authConfig.hpp"
 #include "../resources.hpp"
 #include "../utilities/dataUrl.hpp"
+#include "../utilities/url.hpp"
+#include "../image/image.hpp"
 
 #include <optick.h>
 
@@ -48,6 +50,27 @@ bool startsWith(const std::string &text, const std::string &start)
     return text.substr(0, start.length()) == start;
 }
 
+uint32 fetchClass(FetchTask::ResourceType type)
+{
+    switch (type)
+    {
+    case FetchTask::ResourceType::BoundMetaTile:
+    case FetchTask::ResourceType::MetaTile:
+    case FetchTask::ResourceType::NavTile:
+        return 0;
+    case FetchTask::ResourceType::Mesh:
+        return 1;
+    case FetchTask::ResourceType::Texture:
+        return 2;
+    case FetchTask::ResourceType::GeodataFeatures:
+    case FetchTask::ResourceType::GeodataStylesheet:
+    case FetchTask::ResourceType::Font:
+        return 3;
+    default:
+        return 4;
+    }
+}
+
 } // namespace
 
 void Resources::saveCorruptedFile(const std::shared_ptr<Resource> &r)
@@ -96,9 +119,17 @@ void FetchTaskImpl::fetchDone()
     LOG(debug) << "Resource <" << name << "> finished downloading, " << "http code: " << reply.code << ", content type: <" << reply.contentType << ">, size: " << reply.content.size() << ", expires: " << reply.expires;
     assert(map);
     map->resources->downloads--;
-    map->resources->queFetching.con.notify_one();
+    map->resources->fetchWakeup();
     Resource::State state = Resource::State::fetching;
 
+    map->resources->breakerReport(query.url, reply.code);
+
+    if (reply.code == 200)
+    {
+        map->resources->bytesDownloaded += reply.content.size();
+        map->resources->downloadsCompleted++;
+    }
+
     // handle error or invalid codes
     if (reply.code >= 400 || reply.code < 200)
     {
@@ -162,7 +193,9 @@ void FetchTaskImpl::fetchDone()
         {
             assert(&*rs->fetch == this);
             assert(rs->state == Resource::State::fetching);
-            rs->info.ramMemoryCost = reply.content.size();
+            // the old version of an upgraded resource is still in use
+            (rs->upgrading ? rs->upgradeInfo : rs->info).ramMemoryCost
+                = reply.content.size();
             rs->state = state;
 
             if (state == Resource::State::decodeQueue)
@@ -184,10 +217,23 @@ void Resources::decodeProcess(const std::shared_ptr<Resource> &r)
 {
     assert(r->state == Resource::State::decodeQueue);
     map->statistics.resourcesDecoded++;
-    r->info.gpuMemoryCost = r->info.ramMemoryCost = 0;
+    {
+        ResourceInfo &info = r->upgrading ? r->upgradeInfo : r->info;
+        info.gpuMemoryCost = info.ramMemoryCost = 0;
+    }
     try
     {
         r->decode();
+        if (r->allowRamCache() && r->fetch->reply.content.size() > 0)
+        {
+            // the live resource does not keep the content
+            //   the pool is bounded and drops the oldest items
+            CacheData cd;
+            cd.name = r->name;
+            cd.expires = r->fetch->reply.expires;
+            cd.buffer = std::move(r->fetch->reply.content);
+            ramCacheWrite(std::move(cd));
+        }
         if (r->requiresUpload())
         {
             r->state = Resource::State::uploadQueue;
@@ -214,6 +260,59 @@ void Resources::oneDecode(std::weak_ptr<Resource> w)
     r->map->resources->decodeProcess(r);
 }
 
+uint32 Resources::fetchSelect(const std::vector<std::weak_ptr<Resource>> &q)
+{
+    static constexpr uint32 Classes = MapStatistics::FetchClasses;
+    uint32 best[Classes] = {};
+    std::shared_ptr<Resource> bestResource[Classes]; // keeps it alive for the statistics
+    float bestPriority[Classes] = {};
+    uint32 depth[Classes] = {};
+    for (uint32 i = 0, e = q.size(); i < e; i++)
+    {
+        std::shared_ptr<Resource> r = q[i].lock();
+        if (!r)
+            return i; // discard expired items immediately
+        const uint32 c = fetchClass(r->resourceType());
+        if (depth[c]++ == 0 || r->priority > bestPriority[c])
+        {
+            best[c] = i;
+            bestResource[c] = r;
+            bestPriority[c] = r->priority;
+        }
+    }
+
+    // the class with least service relative to its share goes first
+    const uint32 shares[Classes] = {
+        map->options.fetchShareMeta,
+        map->options.fetchShareMesh,
+        map->options.fetchShareTexture,
+        map->options.fetchShareGeodata,
+        map->options.fetchShareConfig,
+    };
+    uint32 sel = Classes;
+    for (uint32 c = 0; c < Classes; c++)
+    {
+        if (depth[c] && (sel == Classes || fetchVirtualTime[c] < fetchVirtualTime[sel]))
+            sel = c;
+    }
+    assert(sel < Classes);
+    // idle classes do not accumulate any credit
+    for (uint32 c = 0; c < Classes; c++)
+    {
+        if (!depth[c])
+            fetchVirtualTime[c] = std::max(fetchVirtualTime[c], fetchVirtualTime[sel]);
+    }
+    fetchVirtualTime[sel] += 1.0 / std::max(shares[sel], 1u);
+
+    // statistics
+    for (uint32 c = 0; c < Classes; c++)
+        fetchClassDepth[c] = depth[c];
+    const uint32 wait = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - bestResource[sel]->fetchQueueTime).count();
+    fetchClassWaitMs[sel] = (fetchClassWaitMs[sel] * 7 + wait) / 8;
+
+    return best[sel];
+}
+
 float Resources::priority(const std::weak_ptr<Resource> &w)
 {
     std::shared_ptr<Resource> r = w.lock();
@@ -320,6 +419,7 @@ void Resources::oneCacheRead(std::weak_ptr<Resource> w)
     {
         LOG(debug) << "Reading <" << r->name << "> from cache has failed, initializing fetch instead";
         r->state = Resource::State::fetchQueue;
+        r->fetchQueueTime = std::chrono::steady_clock::now();
         r->map->resources->queFetching.push(r);
     }
 }
@@ -330,13 +430,35 @@ void Resources::cacheReadProcess(const std::shared_ptr<Resource> &r)
     assert(r->state == Resource::State::cacheReadQueue);
     if (!r->fetch)
         r->fetch = std::make_shared<FetchTaskImpl>(r);
-    r->info.gpuMemoryCost = r->info.ramMemoryCost = 0;
+    {
+        ResourceInfo &info = r->upgrading ? r->upgradeInfo : r->info;
+        info.gpuMemoryCost = info.ramMemoryCost = 0;
+    }
     CacheData cd;
-    if (r->allowDiskCache() && (cd = cacheRead(r->name)).name == r->name)
+    const bool snapshot = r->allowSnapshot();
+    if (r->allowRamCache() && (cd = ramCacheRead(r->name)).name == r->name)
     {
         r->fetch->reply.expires = cd.expires;
         r->fetch->reply.content = std::move(cd.buffer);
         r->fetch->reply.code = 200;
+        r->state = Resource::State::decodeQueue;
+        queDecode.push(r);
+        map->statistics.resourcesRamLoaded++;
+    }
+    else if (r->allowDiskCache() && !snapshot && r->readDecodedCache())
+    {
+        r->fetch->reply.code = 200;
+        r->state = Resource::State::decodeQueue;
+        queDecode.push(r);
+        map->statistics.resourcesDiskLoaded++;
+    }
+    else if ((r->allowDiskCache() || snapshot) && (cd = cacheRead(r->name, snapshot)).name == r->name)
+    {
+        r->fetch->reply.expires = cd.expires;
+        r->fetch->reply.content = std::move(cd.buffer);
+        r->fetch->reply.code = 200;
+        if (cd.stale)
+            snapshotRevalidate(r);
         if (cd.availFailed)
             r->state = Resource::State::availFail;
         else
@@ -372,9 +494,16 @@ void Resources::cacheReadProcess(const std::shared_ptr<Resource> &r)
         r->state = Resource::State::atmosphereQueue;
         queAtmosphere.push(r);
     }
+    else if (r->warmup)
+    {
+        // the warm-up reads from the disk cache only
+        r->warmup = false;
+        r->state = Resource::State::initializing;
+    }
     else
     {
         r->state = Resource::State::fetchQueue;
+        r->fetchQueueTime = std::chrono::steady_clock::now();
         queFetching.push(r);
     }
 }
@@ -383,40 +512,220 @@ void Resources::cacheReadProcess(const std::shared_ptr<Resource> &r)
 // FETCHER THREAD
 ////////////////////////////
 
+bool Resources::breakerAllow(const std::string &url)
+{
+    if (map->options.fetchBreakerFailures == 0)
+        return true;
+    std::lock_guard<std::mutex> lock(breakersMut);
+    auto it = breakers.find(extractUrlHost(url));
+    if (it == breakers.end())
+        return true;
+    HostBreaker &b = it->second;
+    switch (b.state)
+    {
+    case HostBreaker::State::closed:
+        return true;
+    case HostBreaker::State::open:
+        if (std::chrono::steady_clock::now() < b.reopen)
+            return false;
+        b.state = HostBreaker::State::halfOpen;
+        b.probing = false;
+        UTILITY_FALLTHROUGH;
+    case HostBreaker::State::halfOpen:
+        if (b.probing)
+            return false;
+        LOG(info2) << "Probing failing host <" << it->first << ">";
+        b.probing = true;
+        return true;
+    }
+    return true;
+}
+
+void Resources::breakerReport(const std::string &url, uint32 code)
+{
+    const uint32 threshold = map->options.fetchBreakerFailures;
+    if (threshold == 0)
+        return;
+    // network errors and server failures count against the host
+    const bool failure = code < 100
+        || (code >= 500 && code < 600)
+        || code == FetchTask::ExtraCodes::Timeout
+        || code == FetchTask::ExtraCodes::InternalError;
+    const std::string host = extractUrlHost(url);
+    std::lock_guard<std::mutex> lock(breakersMut);
+    auto it = breakers.find(host);
+    if (!failure)
+    {
+        if (it == breakers.end())
+            return;
+        // downloads started before the breaker opened do not close it
+        if (it->second.state == HostBreaker::State::open)
+            return;
+        if (it->second.state == HostBreaker::State::halfOpen)
+            LOG(info3) << "Host <" << host << "> has recovered";
+        breakers.erase(it);
+        return;
+    }
+    HostBreaker &b = it == breakers.end() ? breakers[host] : it->second;
+    switch (b.state)
+    {
+    case HostBreaker::State::closed:
+        if (++b.failures < threshold)
+            return;
+        break;
+    case HostBreaker::State::open:
+        return; // downloads started before the breaker opened
+    case HostBreaker::State::halfOpen:
+        break; // the probe has failed
+    }
+    b.openings = std::min(b.openings + 1, 5u);
+    const uint32 seconds = map->options.fetchBreakerOpenTime << (b.openings - 1);
+    b.state = HostBreaker::State::open;
+    b.probing = false;
+    b.reopen = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    LOG(warn3) << "Host <" << host << "> is failing, downloads are suspended for " << seconds << " seconds";
+}
+
+sint32 Resources::breakerResume()
+{
+    if (breakerSuspended.empty())
+        return -1;
+    const auto now = std::chrono::steady_clock::now();
+    sint32 timeout = -1;
+    std::vector<std::weak_ptr<Resource>> resume;
+    {
+        std::lock_guard<std::mutex> lock(breakersMut);
+        auto it = breakerSuspended.begin();
+        while (it != breakerSuspended.end())
+        {
+            auto b = breakers.find(it->first);
+            if (b != breakers.end())
+            {
+                const HostBreaker &h = b->second;
+                if (h.state == HostBreaker::State::open && now < h.reopen)
+                {
+                    const sint32 t = (sint32)std::chrono::duration_cast<std::chrono::milliseconds>(h.reopen - now).count() + 1;
+                    timeout = timeout < 0 ? t : std::min(timeout, t);
+                    it++;
+                    continue;
+                }
+                if (h.state == HostBreaker::State::halfOpen && h.probing)
+                {
+                    // the result of the probe wakes the fetcher thread
+                    it++;
+                    continue;
+                }
+            }
+            resume.insert(resume.end(), it->second.begin(), it->second.end());
+            it = breakerSuspended.erase(it);
+        }
+    }
+    for (auto &w : resume)
+        queFetching.push(std::move(w));
+    return timeout;
+}
+
 void Resources::oneFetch(std::weak_ptr<Resource> w)
 {
     std::shared_ptr<Resource> r = w.lock();
     if (!r)
         return;
+    if (!r->map->resources->breakerAllow(r->fetch->query.url))
+    {
+        // the fetch waits for the host to recover
+        //   and does not count as a retry
+        LOG(debug) << "Fetch of <" << r->name << "> suspended, the host is failing";
+        r->map->resources->breakerSuspended[extractUrlHost(r->fetch->query.url)].push_back(w);
+        return;
+    }
+    if (r->map->resources->batchFetch(r))
+        return;
     r->state = Resource::State::fetching;
     r->map->resources->downloads++;
     LOG(debug) << "Initializing fetch of <" << r->name << ">";
     r->fetch->query.headers["X-Vts-Client-Id"] = r->map->createOptions.clientId;
+    if (r->fetch->query.resourceType == FetchTask::ResourceType::Texture)
+        r->fetch->query.headers["Accept"] = imageAcceptHeader();
     if (r->map->auth)
         r->map->auth->authorize(r);
     r->map->fetcher->fetch(r->fetch);
     r->map->statistics.resourcesDownloaded++;
 }
 
+void Resources::preconnect(const std::string &origin)
+{
+    {
+        std::lock_guard<std::mutex> lock(preconnectMut);
+        preconnectOrigins.push_back(origin);
+    }
+    fetchWakeup();
+}
+
+void Resources::preconnectFetch()
+{
+    std::vector<std::string> origins;
+    {
+        std::lock_guard<std::mutex> lock(preconnectMut);
+        if (preconnectOrigins.empty())
+            return;
+        std::swap(origins, preconnectOrigins);
+    }
+    for (const auto &o : origins)
+    {
+        LOG(info1) << "Preconnecting to <" << o << ">";
+        map->fetcher->preconnect(o);
+    }
+}
+
+void Resources::fetchWakeup()
+{
+    {
+        std::lock_guard<std::mutex> lock(queFetching.mut);
+        fetchWakeups++;
+    }
+    queFetching.con.notify_one();
+}
+
 void Resources::fetcherProcessorEntry()
 {
     OPTICK_THREAD("fetcher");
     setLogThreadName("fetcher");
     map->fetcher->initialize();
 
+    uint32 wakeups = 0;
     while (!queFetching.stop)
     {
         {
-            OPTICK_EVENT("update");
-            map->fetcher->update();
+            // any wakeup from now on causes another iteration
+            std::lock_guard<std::mutex> lock(queFetching.mut);
+            wakeups = fetchWakeups;
         }
 
-        if (!(downloads < map->options.maxConcurrentDownloads && queFetching.runOne()))
         {
-            using namespace std::chrono_literals;
-            std::unique_lock<std::mutex> lock(queFetching.mut);
-            queFetching.con.wait_for(lock, 10ms);
+            OPTICK_EVENT("update");
+            map->fetcher->update();
         }
+
+        snapshotFetch();
+        preconnectFetch();
+        const sint32 breakerTimeout = breakerResume();
+
+        if (downloads < map->options.maxConcurrentDownloads && queFetching.runOne())
+            continue;
+
+        // sleep until there is something to do
+        sint32 timeout = map->fetcher->updateTimeout();
+        if (breakerTimeout >= 0)
+            timeout = timeout < 0 ? breakerTimeout : std::min(timeout, breakerTimeout);
+        std::unique_lock<std::mutex> lock(queFetching.mut);
+        const auto ready = [&]() {
+            return queFetching.stop || fetchWakeups != wakeups
+                || (!queFetching.q.empty() && downloads < map->options.maxConcurrentDownloads);
+        };
+        if (timeout < 0)
+            queFetching.con.wait(lock, ready);
+        else
+            queFetching.con.wait_for(lock, std::chrono::milliseconds(timeout), ready);
     }
 
     map->fetcher->finalize();
@@ -439,6 +748,8 @@ bool Resources::tryRemove(std::shared_ptr<Resource> &r)
 {
     const std::string name = r->name;
     assert(resources.count(name) == 1);
+    HotSetEntry hotSetEntry;
+    const bool hotSetAllowed = hotSetPrepare(*r, hotSetEntry);
     {
         // release the pointer if we are the last one holding it
         std::weak_ptr<Resource> w = r;
@@ -461,6 +772,10 @@ bool Resources::tryRemove(std::shared_ptr<Resource> &r)
         LOG(info1) << "Released resource <" << name << ">";
         resources.erase(name);
         map->statistics.resourcesReleased++;
+        if (hotSetAllowed)
+            hotSetRecord(name, hotSetEntry);
+        // evicted content is the most likely to be needed again
+        ramCacheTouch(name);
         return true;
     }
     return false;
@@ -513,6 +828,10 @@ void Resources::removeOld()
     }
     map->statistics.currentGpuMemUseKB = memGpuUse / 1024;
     map->statistics.currentRamMemUseKB = memRamUse / 1024;
+    {
+        std::lock_guard<std::mutex> lock(ramCacheMut);
+        map->statistics.currentRamCacheKB = ramCacheSize / 1024;
+    }
     uint64 memUse = memRamUse + memGpuUse;
     OPTICK_TAG("memUse", memUse);
     // remove unconditionalToRemove
@@ -550,7 +869,7 @@ void Resources::checkInitialized()
     for (const auto &it : resources)
     {
         const std::shared_ptr<Resource> &r = it.second;
-        if (r->lastAccessTick + 3 < map->renderTickIndex)
+        if (r->lastAccessTick + 3 < map->renderTickIndex && !r->warmup)
             continue; // skip resources that were not accessed last few tick
         switch ((Resource::State)r->state)
         {
@@ -564,7 +883,10 @@ void Resources::checkInitialized()
             }
             if (r->retryTime == -1)
             {
-                r->retryTime = (1u << r->retryNumber) * map->options.fetchFirstRetryTimeOffset + current;
+                // the delay is randomized (50 % - 150 %)
+                //   so that retries of many resources do not synchronize
+                const uint32 delay = (1u << r->retryNumber) * map->options.fetchFirstRetryTimeOffset;
+                r->retryTime = std::uniform_int_distribution<uint32>(delay / 2, delay + delay / 2)(retryRandom) + current;
                 LOGR(r->retryNumber < 2 ? dbglog::warn1 : dbglog::warn2) << "Resource <" << r->name << "> may retry in " << (r->retryTime - current) << " seconds";
                 break;
             }
@@ -588,6 +910,11 @@ void Resources::renderFinalize()
 {
     OPTICK_EVENT();
 
+    // remember the most used resources for next time
+    //   the cache write queue is terminated below
+    hotSetSave(true);
+    hotSetWarmup.clear();
+
     // release resources held by the map and all layers
     map->purgeMapconfig();
 
@@ -606,6 +933,95 @@ void Resources::renderFinalize()
     queUpload.con.notify_one();
 }
 
+void Resources::upgradeStart(const std::shared_ptr<Resource> &r)
+{
+    assert(r->state == Resource::State::ready);
+    assert(!r->upgrading);
+    r->upgrading = true;
+    CacheData cd = ramCacheRead(r->name);
+    if (cd.name.empty())
+    {
+        // read it again from the cache or network
+        r->state = Resource::State::initializing;
+        return;
+    }
+    r->fetch = std::make_shared<FetchTaskImpl>(r);
+    r->fetch->reply.content = std::move(cd.buffer);
+    r->fetch->reply.expires = cd.expires;
+    r->fetch->reply.code = 200;
+    r->state = Resource::State::decodeQueue;
+    queDecode.push(r);
+}
+
+void Resources::upgradeFinish(const std::shared_ptr<Resource> &r)
+{
+    // the draws from previous frame are already rendered
+    //   so the old gpu data may be released
+    assert(r->state == Resource::State::ready);
+    std::swap(r->info, r->upgradeInfo);
+    if (r->upgradeInfo.userData)
+        queUpload.push(UploadData(r->upgradeInfo.userData, 0));
+    r->upgradeInfo = ResourceInfo();
+    r->upgrading = false;
+}
+
+void Resources::upgradeAbort(const std::shared_ptr<Resource> &r)
+{
+    // the old version remains valid
+    //   and the upgrade is not attempted again for a while
+    LOG(warn2) << "Upgrading resource <" << r->name
+               << "> has failed, keeping the previous version";
+    if (r->upgradeInfo.userData)
+        queUpload.push(UploadData(r->upgradeInfo.userData, 0));
+    r->upgradeInfo = ResourceInfo();
+    r->upgradeRetryTime = std::time(nullptr) + 60;
+    r->retryNumber = 0;
+    r->retryTime = -1;
+    r->state = Resource::State::ready;
+    r->upgrading = false;
+}
+
+void Resources::throughputUpdate()
+{
+    const auto now = std::chrono::steady_clock::now();
+    const double elapsed = std::chrono::duration<double>(now - throughputTime).count();
+    if (elapsed < 1)
+        return;
+    const uint64 bytes = bytesDownloaded;
+    const uint32 count = downloadsCompleted;
+    const bool busy = downloads > 0;
+
+    // idle intervals say nothing about the network
+    if (busy && throughputBusy && count > throughputCount)
+    {
+        const double sample = (bytes - throughputBytes) / elapsed;
+        const double size = double(bytes - throughputBytes) / (count - throughputCount);
+        throughput = throughput == 0 ? sample : throughput * 0.7 + sample * 0.3;
+        averageDownloadSize = averageDownloadSize == 0 ? size : averageDownloadSize * 0.7 + size * 0.3;
+    }
+    throughputTime = now;
+    throughputBytes = bytes;
+    throughputCount = count;
+    throughputBusy = busy;
+
+    // coarser traversal while the queue takes too long to download
+    const uint32 budget = map->options.fetchTimeBudget;
+    if (budget == 0 || throughput <= 0)
+        downloadLodScale = 1;
+    else
+    {
+        const double pending = (queFetching.estimateSize() + downloads) * averageDownloadSize;
+        const double ms = pending / throughput * 1000;
+        if (ms > budget)
+            downloadLodScale = std::min(downloadLodScale * 1.25, std::max(map->options.fetchLodScaleMax, 1.0));
+        else if (ms < budget * 0.5)
+            downloadLodScale = std::max(downloadLodScale / 1.25, 1.0);
+    }
+
+    map->statistics.downloadThroughputKBps = (uint32)(throughput / 1024);
+    map->statistics.downloadLodScale = downloadLodScale;
+}
+
 void Resources::renderUpdate()
 {
     OPTICK_EVENT();
@@ -626,12 +1042,22 @@ void Resources::renderUpdate()
             case Resource::State::decodeQueue:
             case Resource::State::atmosphereQueue:
             case Resource::State::uploadQueue:
-            case Resource::State::errorRetry:
                 map->statistics.resourcesPreparing++;
                 break;
+            case Resource::State::errorRetry:
+                if (it.second->upgrading)
+                    upgradeAbort(it.second);
+                else
+                    map->statistics.resourcesPreparing++;
+                break;
             case Resource::State::ready:
+                if (it.second->upgrading)
+                    upgradeFinish(it.second);
+                break;
             case Resource::State::errorFatal:
             case Resource::State::availFail:
+                if (it.second->upgrading)
+                    upgradeAbort(it.second);
                 break;
             }
         }
@@ -645,8 +1071,23 @@ void Resources::renderUpdate()
         map->statistics.resourcesQueueDecode = queDecode.estimateSize();
         map->statistics.resourcesQueueAtmosphere = queAtmosphere.estimateSize();
         map->statistics.resourcesQueueUpload = queUpload.estimateSize();
+        {
+            std::lock_guard<std::mutex> lock(queFetching.mut);
+            for (uint32 c = 0; c < MapStatistics::FetchClasses; c++)
+            {
+                map->statistics.resourcesQueueDownloadPerClass[c] = queFetching.q.empty() ? 0 : fetchClassDepth[c];
+                map->statistics.resourcesDownloadWaitMsPerClass[c] = fetchClassWaitMs[c];
+            }
+        }
+        if (map->renderTickIndex % 30 == 0)
+            map->statistics.hostConnectionsWindows = map->fetcher->hostConnectionsWindows();
     }
 
+    snapshotUpdate();
+    hotSetUpdate();
+    batchUpdate();
+    throughputUpdate();
+
     // split workload into multiple render frames
     switch (map->renderTickIndex % 2)
     {
@@ -0,0 +1,230 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../include/vts-browser/log.hpp"
+
+#include "../fetchTask.hpp"
+#include "../resources.hpp"
+#include "../resource.hpp"
+#include "../authConfig.hpp"
+#include "../mapConfig.hpp"
+#include "../map.hpp"
+
+#include <utility/md5.hpp>
+#include <optick.h>
+
+namespace vts
+{
+
+namespace
+{
+
+std::string contentHash(const Buffer &buffer)
+{
+    char digest[16];
+    utility::md5::hash(buffer.data(), buffer.size(), digest);
+    return std::string(digest, digest + 16);
+}
+
+bool reloadAsUpgrade(const std::shared_ptr<Resource> &r)
+{
+    return r->resourceType() == FetchTask::ResourceType::Texture
+        && (r->state == Resource::State::ready || r->upgrading);
+}
+
+} // namespace
+
+SnapshotRevalidateTask::SnapshotRevalidateTask(const std::shared_ptr<Resource> &resource) : FetchTask(resource->name, resource->resourceType()), name(resource->name), map(resource->map), snapshotHash(contentHash(resource->fetch->reply.content))
+{
+    reply.expires = -1;
+}
+
+////////////////////////////
+// A FETCH THREAD
+////////////////////////////
+
+void SnapshotRevalidateTask::fetchDone()
+{
+    OPTICK_EVENT();
+    LOG(debug) << "Resource <" << name << "> finished revalidating, " << "http code: " << reply.code << ", size: " << reply.content.size();
+    map->resources->downloads--;
+    map->resources->fetchWakeup();
+
+    if (reply.code != 200)
+    {
+        LOG(warn1) << "Failed revalidating <" << name << ">, http code " << reply.code << ", the snapshot is kept";
+        // allow another attempt next time the resource is read from the snapshot
+        std::lock_guard<std::mutex> lock(map->resources->snapshotMut);
+        map->resources->snapshotRevalidated.erase(name);
+        return;
+    }
+
+    // some resources must always revalidate
+    if (!Resource::allowDiskCache(query.resourceType))
+        reply.expires = -2;
+
+    const bool changed = contentHash(reply.content) != snapshotHash;
+    CacheData cd;
+    cd.name = name;
+    cd.expires = reply.expires;
+    cd.buffer = std::move(reply.content);
+
+    if (!changed)
+    {
+        // refresh expiration of the snapshot
+        if (map->resources->queCacheWrite.estimateSize() < map->options.maxCacheWriteQueueLength)
+            map->resources->queCacheWrite.push(std::move(cd));
+        return;
+    }
+
+    LOG(info2) << "Resource <" << name << "> has changed since the snapshot";
+
+    // the new content must be in the cache before the resource is reloaded
+    map->resources->cacheWrite(cd);
+    std::lock_guard<std::mutex> lock(map->resources->snapshotMut);
+    map->resources->snapshotChanged.push_back(name);
+}
+
+void Resources::snapshotFetch()
+{
+    std::vector<std::shared_ptr<FetchTask>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(snapshotMut);
+        if (snapshotRevalidations.empty())
+            return;
+        std::swap(tasks, snapshotRevalidations);
+    }
+    for (const auto &t : tasks)
+    {
+        downloads++;
+        LOG(debug) << "Initializing revalidation of <" << t->query.url << ">";
+        t->query.headers["X-Vts-Client-Id"] = map->createOptions.clientId;
+        if (map->auth)
+            map->auth->authorize(t->query.url, t->query);
+        map->fetcher->fetch(t);
+        map->statistics.resourcesDownloaded++;
+    }
+}
+
+////////////////////////////
+// CACHE READ THREAD
+////////////////////////////
+
+void Resources::snapshotRevalidate(const std::shared_ptr<Resource> &r)
+{
+    {
+        std::lock_guard<std::mutex> lock(snapshotMut);
+        if (!snapshotRevalidated.insert(r->name).second)
+            return; // already revalidated in this session
+    }
+    LOG(info1) << "Resource <" << r->name << "> loaded from snapshot, revalidating in background";
+    auto t = std::make_shared<SnapshotRevalidateTask>(r);
+    {
+        std::lock_guard<std::mutex> lock(snapshotMut);
+        snapshotRevalidations.push_back(t);
+    }
+    fetchWakeup();
+}
+
+////////////////////////////
+// MAIN THREAD
+////////////////////////////
+
+void Resources::snapshotUpdate()
+{
+    std::vector<std::string> changed;
+    {
+        std::lock_guard<std::mutex> lock(snapshotMut);
+        if (snapshotChanged.empty())
+            return;
+        std::swap(changed, snapshotChanged);
+    }
+
+    OPTICK_EVENT();
+    std::vector<std::shared_ptr<Resource>> reload;
+    std::vector<std::string> pending;
+    bool reconfigure = false;
+    for (const std::string &name : changed)
+    {
+        auto it = resources.find(name);
+        if (it == resources.end())
+            continue; // the new content will be used when the resource is requested again
+        switch ((Resource::State)it->second->state)
+        {
+        case Resource::State::ready:
+        case Resource::State::errorFatal:
+        case Resource::State::errorRetry:
+        case Resource::State::availFail:
+            break;
+        default:
+            // wait for the resource to finish processing
+            pending.push_back(name);
+            continue;
+        }
+        if (!it->second->allowDiskCache())
+            reconfigure = true;
+        reload.push_back(it->second);
+    }
+
+    if (!pending.empty())
+    {
+        std::lock_guard<std::mutex> lock(snapshotMut);
+        snapshotChanged.insert(snapshotChanged.end(), pending.begin(), pending.end());
+    }
+
+    if (reconfigure)
+    {
+        LOG(info3) << "Configuration has changed since the snapshot, switching over";
+        if (map->mapconfig)
+            reload.push_back(map->mapconfig);
+        map->purgeMapconfig();
+    }
+
+    // textures are swapped in by the main thread once the new version is ready,
+    //   other resources are decoded in place
+    //   and the traversal, which uses them, is purged first
+    bool purge = false;
+    for (const auto &r : reload)
+    {
+        if (!reloadAsUpgrade(r))
+            purge = true;
+    }
+    if (purge && !reconfigure)
+        map->purgeViewCache();
+
+    for (const auto &r : reload)
+    {
+        LOG(info2) << "Reloading resource <" << r->name << "> after revalidation";
+        ramCacheRead(r->name); // drop the outdated content
+        if (reloadAsUpgrade(r))
+            r->upgrading = true;
+        r->retryNumber = 0;
+        r->retryTime = -1;
+        r->state = Resource::State::initializing;
+    }
+}
+
+} // namespace vts
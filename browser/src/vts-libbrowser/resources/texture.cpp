@@ -27,16 +27,198 @@
 #include "../image/image.hpp"
 #include "../gpuResource.hpp"
 #include "../fetchTask.hpp"
+#include "../resources.hpp"
 #include "../map.hpp"
 
 #include <dbglog/dbglog.hpp>
+#include <ctime>
 
 namespace vts
 {
 
-GpuTextureSpec::GpuTextureSpec(const Buffer &buffer)
+namespace
 {
-    decodeImage(buffer, this->buffer, width, height, components);
+
+static const char DecodedMagic[] = "vtstex";
+static const uint16 DecodedVersion = 4;
+static const sint64 DecodedMaxAge = 30 * 24 * 3600; // seconds
+
+struct DecodedHeader
+{
+    char magic[8];
+    uint16 version;
+    uint16 components;
+    uint32 width;
+    uint32 height;
+    uint32 type;
+    uint32 internalFormat;
+    uint32 scale;
+    uint32 compression;
+    uint32 mipmapLevels;
+    sint64 sourceExpires; // expiration of the encoded image
+};
+
+std::string decodedCacheName(const std::string &name)
+{
+    auto p = name.find("://");
+    return std::string("decoded/")
+        + (p == std::string::npos ? name : name.substr(p + 3));
+}
+
+bool allowDecodedCache(const GpuTexture *t)
+{
+    if (!t->map->createOptions.decodedTextureCache
+        || !t->map->createOptions.diskCache)
+        return false;
+    // local resources are cheap to decode
+    return t->name.find("://") != std::string::npos
+        && t->name.compare(0, 11, "internal://") != 0
+        && t->name.compare(0, 7, "file://") != 0;
+}
+
+// value of the textureCompression option that produces the format
+uint32 compressionOption(GpuTextureSpec::Compression c)
+{
+    switch (c)
+    {
+    case GpuTextureSpec::Compression::Bc1:
+    case GpuTextureSpec::Compression::Bc3:
+        return 1;
+    case GpuTextureSpec::Compression::Etc2Rgb:
+    case GpuTextureSpec::Compression::Etc2Rgba:
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+// compression of the texture, if it is supported by the gpu
+uint32 textureCompression(const GpuTexture *t)
+{
+    // imagery is compressed, icons and other textures are kept exact
+    const uint32 c = t->surfaceTexture
+        ? t->map->options.textureCompression : 0;
+    const auto &supported = t->map->callbacks.textureCompressionSupported;
+    if (c == 0 || !supported)
+        return c;
+    // both opaque and transparent formats are needed
+    typedef GpuTextureSpec::Compression C;
+    if (c == 1 ? supported((uint32)C::Bc1) && supported((uint32)C::Bc3)
+        : supported((uint32)C::Etc2Rgb) && supported((uint32)C::Etc2Rgba))
+        return c;
+    return 0;
+}
+
+// whether the decode produces the full mipmap chain
+bool decodeMipmaps(const GpuTexture *t, uint32 compression)
+{
+    // the gpu cannot generate mipmaps for compressed textures
+    if (compression)
+        return true;
+    if (!t->map->options.textureMipmapsOnDecode)
+        return false;
+    switch (t->filterMode)
+    {
+    case GpuTextureSpec::FilterMode::Nearest:
+    case GpuTextureSpec::FilterMode::Linear:
+        return false;
+    default:
+        return true;
+    }
+}
+
+// compression applied to a decoded image,
+//   only 8 bit images with 3 or 4 components are compressed
+uint32 appliedCompression(uint32 compression, GpuTypeEnum type,
+    uint32 components)
+{
+    if (type != GpuTypeEnum::UnsignedByte
+        || (components != 3 && components != 4))
+        return 0;
+    return compression;
+}
+
+// whether the decoded image carries the full mipmap chain
+bool appliedMipmaps(const GpuTexture *t, uint32 compression,
+    GpuTypeEnum type, uint32 components)
+{
+    if (appliedCompression(compression, type, components))
+        return true;
+    return decodeMipmaps(t, 0) && type == GpuTypeEnum::UnsignedByte;
+}
+
+uint32 fullMipmapLevels(uint32 width, uint32 height)
+{
+    uint32 levels = 1;
+    while ((width >> levels) > 0 || (height >> levels) > 0)
+        levels++;
+    return levels;
+}
+
+bool readDecoded(const GpuTexture *t, const Buffer &cached,
+    GpuTextureSpec &spec, uint32 &scale, uint32 compression,
+    sint64 &sourceExpires)
+{
+    if (cached.size() < sizeof(DecodedHeader))
+        return false;
+    const DecodedHeader *h = (const DecodedHeader*)cached.data();
+    if (memcmp(h->magic, DecodedMagic, sizeof(DecodedMagic)) != 0
+        || h->version != DecodedVersion
+        || h->scale > scale)
+        return false;
+    // the entry must match what the decode would produce now
+    const GpuTypeEnum type = (GpuTypeEnum)h->type;
+    if (compressionOption((GpuTextureSpec::Compression)h->compression)
+            != appliedCompression(compression, type, h->components)
+        || h->mipmapLevels != (appliedMipmaps(t, compression, type,
+            h->components) ? fullMipmapLevels(h->width, h->height) : 1))
+        return false;
+    scale = h->scale;
+    sourceExpires = h->sourceExpires;
+    spec.width = h->width;
+    spec.height = h->height;
+    spec.components = h->components;
+    spec.type = (GpuTypeEnum)h->type;
+    spec.internalFormat = h->internalFormat;
+    spec.compression = (GpuTextureSpec::Compression)h->compression;
+    spec.mipmapLevels = h->mipmapLevels;
+    if (cached.size() != sizeof(DecodedHeader) + spec.expectedSize())
+        return false;
+    spec.buffer = Buffer(spec.expectedSize());
+    memcpy(spec.buffer.data(), cached.data() + sizeof(DecodedHeader),
+        spec.buffer.size());
+    return true;
+}
+
+Buffer writeDecoded(const GpuTextureSpec &spec, sint64 sourceExpires,
+    uint32 scale)
+{
+    Buffer b(sizeof(DecodedHeader) + spec.buffer.size());
+    memset(b.data(), 0, sizeof(DecodedHeader)); // initialize structure padding
+    DecodedHeader *h = (DecodedHeader*)b.data();
+    memcpy(h->magic, DecodedMagic, sizeof(DecodedMagic));
+    h->version = DecodedVersion;
+    h->components = spec.components;
+    h->width = spec.width;
+    h->height = spec.height;
+    h->type = (uint32)spec.type;
+    h->internalFormat = spec.internalFormat;
+    h->scale = scale;
+    h->compression = (uint32)spec.compression;
+    h->mipmapLevels = spec.mipmapLevels;
+    h->sourceExpires = sourceExpires;
+    memcpy(b.data() + sizeof(DecodedHeader),
+        spec.buffer.data(), spec.buffer.size());
+    return b;
+}
+
+} // namespace
+
+GpuTextureSpec::GpuTextureSpec(const Buffer &buffer, bool bottomUp)
+{
+    uint32 scale = 1;
+    decodeImage(buffer, this->buffer, width, height, components,
+        scale, bottomUp);
 }
 
 void GpuTextureSpec::verticalFlip()
@@ -56,7 +238,114 @@ void GpuTextureSpec::verticalFlip()
 
 uint32 GpuTextureSpec::expectedSize() const
 {
-    return width * height * components * gpuTypeSize(type);
+    uint32 size = 0;
+    for (uint32 level = 0; level < mipmapLevels; level++)
+        size += levelSize(level);
+    return size;
+}
+
+uint32 GpuTextureSpec::levelSize(uint32 level) const
+{
+    const uint32 w = std::max(width >> level, 1u);
+    const uint32 h = std::max(height >> level, 1u);
+    switch (compression)
+    {
+    case Compression::None:
+        return w * h * components * gpuTypeSize(type);
+    case Compression::Bc1:
+    case Compression::Etc2Rgb:
+        return ((w + 3) / 4) * ((h + 3) / 4) * 8;
+    case Compression::Bc3:
+    case Compression::Etc2Rgba:
+        return ((w + 3) / 4) * ((h + 3) / 4) * 16;
+    }
+    return 0;
+}
+
+void GpuTextureSpec::generateMipmaps()
+{
+    if (compression != Compression::None || mipmapLevels != 1
+        || type != GpuTypeEnum::UnsignedByte)
+    {
+        LOGTHROW(err2, std::runtime_error) << "Unsupported texture "
+            "for mipmaps generation.";
+    }
+
+    uint32 levels = 1;
+    while ((width >> levels) > 0 || (height >> levels) > 0)
+        levels++;
+    std::vector<Buffer> chain;
+    chain.reserve(levels);
+    chain.push_back(std::move(buffer));
+    uint32 w = width, h = height;
+    for (uint32 l = 1; l < levels; l++)
+    {
+        Buffer tmp;
+        downsampleImage(chain.back(), tmp, w, h, components,
+            components >= 3);
+        chain.push_back(std::move(tmp));
+    }
+
+    mipmapLevels = levels;
+    buffer = Buffer(expectedSize());
+    uint32 offset = 0;
+    for (const Buffer &b : chain)
+    {
+        memcpy(buffer.data() + offset, b.data(), b.size());
+        offset += b.size();
+    }
+    assert(offset == buffer.size());
+}
+
+void GpuTextureSpec::compress(bool bc)
+{
+    if (compression != Compression::None
+        || type != GpuTypeEnum::UnsignedByte
+        || (components != 3 && components != 4))
+    {
+        LOGTHROW(err2, std::runtime_error) << "Unsupported texture "
+            "for compression.";
+    }
+
+    // the gpu cannot generate mipmaps for compressed textures
+    if (mipmapLevels == 1)
+        generateMipmaps();
+
+    bool alpha = false;
+    if (components == 4)
+    {
+        const unsigned char *p = (const unsigned char *)buffer.data();
+        for (uint32 i = 3, e = buffer.size(); i < e && !alpha; i += 4)
+            alpha = p[i] != 255;
+    }
+    typedef void (*Func)(const unsigned char *, uint32, uint32, uint32,
+                         unsigned char *);
+    Func func;
+    if (bc)
+    {
+        compression = alpha ? Compression::Bc3 : Compression::Bc1;
+        func = alpha ? &compressBc3 : &compressBc1;
+    }
+    else
+    {
+        compression = alpha ? Compression::Etc2Rgba : Compression::Etc2Rgb;
+        func = alpha ? &compressEtc2Rgba : &compressEtc2Rgb;
+    }
+
+    Buffer out(expectedSize());
+    uint32 offset = 0, inOffset = 0;
+    for (uint32 l = 0; l < mipmapLevels; l++)
+    {
+        const uint32 w = std::max(width >> l, 1u);
+        const uint32 h = std::max(height >> l, 1u);
+        func((const unsigned char *)buffer.data() + inOffset, w, h,
+            components, (unsigned char *)out.data() + offset);
+        inOffset += w * h * components;
+        offset += levelSize(l);
+    }
+    assert(offset == out.size());
+    assert(inOffset == buffer.size());
+    buffer = std::move(out);
 }
 
 Buffer GpuTextureSpec::encodePng() const
@@ -78,10 +367,23 @@ GpuTexture::GpuTexture(MapImpl *map, const std::string &name) :
 void GpuTexture::decode()
 {
     LOG(info1) << "Decoding texture <" << name << ">";
+
+    // already read from the decoded cache
+    if (decodeData)
+        return;
+
+    const bool decodedCache = allowDecodedCache(this);
+    uint32 scale = requestedScale;
+    const uint32 compression = textureCompression(this);
+
     std::shared_ptr<GpuTextureSpec> spec
-        = std::make_shared<GpuTextureSpec>(fetch->reply.content);
+        = std::make_shared<GpuTextureSpec>();
+    // decoded bottom-up, as expected by opengl
+    decodeImage(fetch->reply.content, spec->buffer,
+        spec->width, spec->height, spec->components, scale, true);
     this->width = spec->width;
     this->height = spec->height;
+    this->decodedScale = scale;
     spec->filterMode = filterMode;
     spec->wrapMode = wrapMode;
 
@@ -96,26 +398,108 @@ void GpuTexture::decode()
         if (!boost::filesystem::exists(path))
         {
             boost::filesystem::create_directories(prefix + b);
+            GpuTextureSpec s;
+            s.width = spec->width;
+            s.height = spec->height;
+            s.components = spec->components;
+            s.buffer = spec->buffer.copy();
+            s.verticalFlip();
             Buffer out;
-            encodePng(spec->buffer, out,
-                spec->width, spec->height, spec->components);
+            encodePng(s.buffer, out, s.width, s.height, s.components);
             writeLocalFileBuffer(path, out);
         }
     }
 #endif
 
-    spec->verticalFlip();
+    const uint32 applied = appliedCompression(compression,
+        spec->type, spec->components);
+    if (applied)
+        spec->compress(applied == 1);
+    else if (appliedMipmaps(this, 0, spec->type, spec->components))
+        spec->generateMipmaps();
+
+    decodeData = std::static_pointer_cast<void>(spec);
+
+    // the decoded entry expires together with the encoded image
+    //   but is kept for limited time only
+    const sint64 sourceExpires = fetch->reply.expires;
+    if (decodedCache && sourceExpires >= 0
+        && map->resources->queCacheWrite.estimateSize()
+        < map->options.maxCacheWriteQueueLength)
+    {
+        const sint64 limit = std::time(nullptr) + DecodedMaxAge;
+        CacheData cd;
+        cd.name = decodedCacheName(name);
+        cd.buffer = writeDecoded(*spec, sourceExpires, scale);
+        cd.expires = sourceExpires > 0
+            ? std::min(sourceExpires, limit) : limit;
+        map->resources->queCacheWrite.push(std::move(cd));
+    }
+}
+
+bool GpuTexture::readDecodedCache()
+{
+    if (!allowDecodedCache(this))
+        return false;
+
+    // the entry is keyed by the name and shares expiration
+    //   with the encoded image, which therefore need not be read
+    CacheData cd = map->resources->cacheRead(decodedCacheName(name));
+    if (cd.name.empty())
+        return false;
+    uint32 scale = requestedScale;
+    const uint32 compression = textureCompression(this);
+    std::shared_ptr<GpuTextureSpec> spec
+        = std::make_shared<GpuTextureSpec>();
+    sint64 sourceExpires = 0;
+    if (!readDecoded(this, cd.buffer, *spec, scale, compression,
+        sourceExpires))
+        return false;
+    LOG(debug) << "Texture <" << name << "> read from decoded cache";
+    this->width = spec->width;
+    this->height = spec->height;
+    this->decodedScale = scale;
+    spec->filterMode = filterMode;
+    spec->wrapMode = wrapMode;
     decodeData = std::static_pointer_cast<void>(spec);
+    fetch->reply.expires = sourceExpires;
+    return true;
 }
 
 void GpuTexture::upload()
 {
     LOG(info2) << "Uploading texture <" << name << ">";
     auto spec = std::static_pointer_cast<GpuTextureSpec>(decodeData);
+    if (upgrading)
+    {
+        // the current texture may still be in use for rendering
+        map->callbacks.loadTexture(upgradeInfo, *spec, name);
+        upgradeInfo.ramMemoryCost += sizeof(*this);
+        return;
+    }
     map->callbacks.loadTexture(info, *spec, name);
     info.ramMemoryCost += sizeof(*this);
 }
 
+void GpuTexture::requestScale(uint32 scale)
+{
+    surfaceTexture = true;
+    if (map->renderTickIndex != requestedTick)
+    {
+        requestedTick = map->renderTickIndex;
+        requestedScale = scale;
+    }
+    else if (scale < requestedScale)
+        requestedScale = scale;
+    if (requestedScale < decodedScale && state == Resource::State::ready
+        && !upgrading && std::time(nullptr) >= upgradeRetryTime)
+    {
+        LOG(debug) << "Upgrading texture <" << name << "> from scale "
+            << decodedScale << " to " << requestedScale;
+        map->resources->upgradeStart(shared_from_this());
+    }
+}
+
 FetchTask::ResourceType GpuTexture::resourceType() const
 {
     return FetchTask::ResourceType::Texture;
@@ -0,0 +1,235 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "meshOptimize.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace vts
+{
+
+namespace
+{
+
+// Sander, Nehab, Barczak: Fast Triangle Reordering
+//   for Vertex Locality and Reduced Overdraw
+void tipsify(uint16 *indices, uint32 indicesCount, uint32 verticesCount,
+             uint32 cacheSize)
+{
+    const uint32 trianglesCount = indicesCount / 3;
+
+    // vertex to triangles adjacency
+    std::vector<uint32> live(verticesCount, 0);
+    for (uint32 i = 0; i < indicesCount; i++)
+        live[indices[i]]++;
+    std::vector<uint32> offsets(verticesCount + 1, 0);
+    for (uint32 v = 0; v < verticesCount; v++)
+        offsets[v + 1] = offsets[v] + live[v];
+    std::vector<uint32> adjacency(indicesCount);
+    {
+        std::vector<uint32> fill(offsets.begin(), offsets.end() - 1);
+        for (uint32 i = 0; i < indicesCount; i++)
+            adjacency[fill[indices[i]]++] = i / 3;
+    }
+
+    std::vector<uint32> cacheTime(verticesCount, 0);
+    std::vector<bool> emitted(trianglesCount, false);
+    std::vector<uint32> deadEnd;
+    deadEnd.reserve(indicesCount);
+    std::vector<uint32> candidates;
+    std::vector<uint16> out;
+    out.reserve(indicesCount);
+    uint32 timestamp = cacheSize + 1;
+    uint32 cursor = 0;
+    sint64 fanning = 0;
+
+    while (fanning >= 0)
+    {
+        const uint32 f = (uint32)fanning;
+        candidates.clear();
+        for (uint32 a = offsets[f], ae = offsets[f + 1]; a != ae; a++)
+        {
+            const uint32 t = adjacency[a];
+            if (emitted[t])
+                continue;
+            emitted[t] = true;
+            for (uint32 j = 0; j < 3; j++)
+            {
+                const uint16 v = indices[t * 3 + j];
+                out.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (timestamp - cacheTime[v] > cacheSize)
+                    cacheTime[v] = timestamp++;
+            }
+        }
+
+        // prefer a vertex that is still in the cache
+        fanning = -1;
+        sint64 best = -1;
+        for (uint32 v : candidates)
+        {
+            if (live[v] == 0)
+                continue;
+            sint64 priority = 0;
+            if (timestamp - cacheTime[v] + 2 * live[v] <= cacheSize)
+                priority = timestamp - cacheTime[v];
+            if (priority > best)
+            {
+                best = priority;
+                fanning = v;
+            }
+        }
+        if (fanning >= 0)
+            continue;
+
+        // dead end, try recently used vertices, then scan for any
+        while (!deadEnd.empty() && fanning < 0)
+        {
+            const uint32 v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0)
+                fanning = v;
+        }
+        while (cursor < verticesCount && fanning < 0)
+        {
+            if (live[cursor] > 0)
+                fanning = cursor;
+            cursor++;
+        }
+    }
+
+    assert(out.size() == indicesCount);
+    memcpy(indices, out.data(), indicesCount * sizeof(uint16));
+}
+
+} // namespace
+
+void optimizeMeshCache(GpuMeshSpec &spec, uint32 cacheSize)
+{
+    if (spec.faceMode != GpuMeshSpec::FaceMode::Triangles
+        || spec.indexMode != GpuTypeEnum::UnsignedShort
+        || spec.indicesCount == 0 || spec.indicesCount % 3 != 0
+        || spec.indices.size() != spec.indicesCount * sizeof(uint16))
+        return;
+
+    uint16 *indices = (uint16*)spec.indices.data();
+    for (uint32 i = 0; i < spec.indicesCount; i++)
+    {
+        if (indices[i] >= spec.verticesCount)
+            return;
+    }
+
+    tipsify(indices, spec.indicesCount, spec.verticesCount, cacheSize);
+
+    // vertices in order of first use, unused vertices at the end
+    const uint32 stride = spec.attributes[0].stride;
+    if (stride == 0 || spec.vertices.size() != spec.verticesCount * stride)
+        return;
+    for (const auto &a : spec.attributes)
+    {
+        if (a.enable && a.stride != stride)
+            return;
+    }
+    static const uint32 Unused = (uint32)-1;
+    std::vector<uint32> remap(spec.verticesCount, Unused);
+    uint32 next = 0;
+    for (uint32 i = 0; i < spec.indicesCount; i++)
+    {
+        if (remap[indices[i]] == Unused)
+            remap[indices[i]] = next++;
+        indices[i] = remap[indices[i]];
+    }
+    for (uint32 &r : remap)
+    {
+        if (r == Unused)
+            r = next++;
+    }
+    Buffer vertices(spec.vertices.size());
+    for (uint32 v = 0; v < spec.verticesCount; v++)
+    {
+        memcpy(vertices.data() + remap[v] * stride,
+               spec.vertices.data() + v * stride, stride);
+    }
+    spec.vertices = std::move(vertices);
+}
+
+bool quantizeMeshPositions(GpuMeshSpec &spec, mat4 &dequantize)
+{
+    GpuMeshSpec::VertexAttribute &pos = spec.attributes[0];
+    if (!pos.enable || pos.type != GpuTypeEnum::Float
+        || pos.components != 3 || pos.offset != 0
+        || spec.vertices.size() != spec.verticesCount * pos.stride)
+        return false;
+    for (const auto &a : spec.attributes)
+    {
+        if (a.enable && a.stride != pos.stride)
+            return false;
+    }
+
+    // 3 x uint16 positions padded to 4 byte alignment
+    static const uint32 saved = sizeof(vec3f) - 4 * sizeof(uint16);
+    const uint32 oldStride = pos.stride;
+    const uint32 newStride = oldStride - saved;
+    Buffer vertices(spec.verticesCount * newStride);
+    for (uint32 v = 0; v < spec.verticesCount; v++)
+    {
+        const char *in = spec.vertices.data() + v * oldStride;
+        char *out = vertices.data() + v * newStride;
+        const float *p = (const float*)in;
+        uint16 *q = (uint16*)out;
+        for (uint32 i = 0; i < 3; i++)
+        {
+            const float f = std::min(std::max(p[i], -1.f), 1.f);
+            q[i] = (uint16)std::round((f + 1) * 0.5f * 65535);
+        }
+        q[3] = 0;
+        memcpy(out + 4 * sizeof(uint16), in + sizeof(vec3f),
+               oldStride - sizeof(vec3f));
+    }
+    spec.vertices = std::move(vertices);
+
+    for (auto &a : spec.attributes)
+    {
+        if (!a.enable)
+            continue;
+        a.stride = newStride;
+        if (a.offset > 0)
+            a.offset -= saved;
+    }
+    pos.type = GpuTypeEnum::UnsignedShort;
+    pos.normalized = true;
+
+    // 0 .. 1 -> -1 .. 1
+    dequantize = translationMatrix(-1, -1, -1) * scaleMatrix(2);
+    return true;
+}
+
+} // namespace vts
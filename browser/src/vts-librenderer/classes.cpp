@@ -466,18 +466,75 @@ bool gpuTypeInteger(GpuTypeEnum type)
 void Texture::load(ResourceInfo &info, vts::GpuTextureSpec &spec,
     const std::string &debugId)
 {
-    assert(spec.buffer.size() == spec.width * spec.height
-           * spec.components * gpuTypeSize(spec.type)
+    assert(spec.buffer.size() == spec.expectedSize()
            || spec.buffer.size() == 0);
+    if (spec.compression != GpuTextureSpec::Compression::None
+        && !textureCompressionSupported((uint32)spec.compression))
+        throw std::invalid_argument("unsupported texture compression");
 
     clear();
     glGenTextures(1, &id);
     glBindTexture(GL_TEXTURE_2D, id);
-    glTexImage2D(GL_TEXTURE_2D, 0, findInternalFormat(spec),
-                 spec.width, spec.height, 0,
-                 findFormat(spec), (GLenum)spec.type, spec.buffer.data());
+    const bool compressed
+        = spec.compression != GpuTextureSpec::Compression::None;
+    const bool mipmaps = spec.mipmapLevels > 1 || !compressed;
+    bool generate = false;
+    switch (spec.filterMode)
+    {
+    case GpuTextureSpec::FilterMode::Nearest:
+    case GpuTextureSpec::FilterMode::Linear:
+        break;
+    default:
+        // the mipmaps may already be provided in the spec
+        generate = spec.mipmapLevels == 1 && mipmaps;
+        break;
+    }
+
+    // immutable storage is allocated once, all levels included,
+    //   the upload itself is then proportional to the provided data
+    const bool storage = glTexStorage2D && spec.buffer.size() > 0;
+    if (storage)
+    {
+        uint32 levels = spec.mipmapLevels;
+        if (generate)
+        {
+            // room for the glGenerateMipmap
+            while ((spec.width >> levels) > 0 || (spec.height >> levels) > 0)
+                levels++;
+        }
+        glTexStorage2D(GL_TEXTURE_2D, levels, compressed
+            ? (GLenum)spec.compression : findInternalFormat(spec),
+            spec.width, spec.height);
+    }
+    uint32 offset = 0;
+    for (uint32 level = 0; level < spec.mipmapLevels; level++)
+    {
+        const uint32 w = std::max(spec.width >> level, 1u);
+        const uint32 h = std::max(spec.height >> level, 1u);
+        const unsigned char *data = spec.buffer.size()
+            ? (const unsigned char *)spec.buffer.data() + offset : nullptr;
+        if (storage && compressed)
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, w, h,
+                (GLenum)spec.compression, spec.levelSize(level), data);
+        else if (storage)
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, w, h,
+                findFormat(spec), (GLenum)spec.type, data);
+        else if (compressed)
+            glCompressedTexImage2D(GL_TEXTURE_2D, level,
+                (GLenum)spec.compression, w, h, 0,
+                spec.levelSize(level), data);
+        else
+            glTexImage2D(GL_TEXTURE_2D, level, findInternalFormat(spec),
+                w, h, 0, findFormat(spec), (GLenum)spec.type, data);
+        offset += spec.levelSize(level);
+    }
+    if (spec.mipmapLevels > 1 || !mipmaps)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+            spec.mipmapLevels - 1);
+    }
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-        (GLenum)spec.filterMode);
+        (GLenum)(mipmaps ? spec.filterMode : magFilter(spec.filterMode)));
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
         (GLenum)magFilter(spec.filterMode));
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
@@ -492,15 +549,8 @@ void Texture::load(ResourceInfo &info, vts::GpuTextureSpec &spec,
                         maxAnisotropySamples);
     }
 
-    switch (spec.filterMode)
-    {
-    case GpuTextureSpec::FilterMode::Nearest:
-    case GpuTextureSpec::FilterMode::Linear:
-        break;
-    default:
+    if (generate)
         glGenerateMipmap(GL_TEXTURE_2D);
-        break;
-    }
 
     grayscale = spec.components == 1;
     setDebugId(debugId);
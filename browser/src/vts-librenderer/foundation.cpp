@@ -26,6 +26,8 @@
 
 #include "renderer.hpp"
 
+#include <algorithm>
+
 void initializeRenderData();
 namespace
 {
@@ -46,6 +48,7 @@ namespace vts { namespace renderer
 
 uint32 maxAntialiasingSamples = 1;
 float maxAnisotropySamples = 0.f;
+std::vector<uint32> compressedTextureFormats;
 
 void checkGlImpl(const char *name)
 {
@@ -210,6 +213,15 @@ void loadGlFunctions(GLADloadproc functionLoader)
     maxAntialiasingSamples = 0;
     glGetIntegerv(GL_MAX_SAMPLES, (GLint*)&maxAntialiasingSamples);
 
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+        compressedTextureFormats.resize(count);
+        if (count > 0)
+            glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS,
+                (GLint*)compressedTextureFormats.data());
+    }
+
     checkGlImpl("load gl extensions and attributes");
 
     vts::log(vts::LogLevel::info2, std::string("OpenGL vendor: ")
@@ -224,11 +236,22 @@ void loadGlFunctions(GLADloadproc functionLoader)
         std::stringstream ss;
         ss << "GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT: " << maxAnisotropySamples
             << ", GL_MAX_SAMPLES: " << maxAntialiasingSamples
-            << ", GL_KHR_debug: " << GLAD_GL_KHR_debug;
+            << ", GL_KHR_debug: " << GLAD_GL_KHR_debug
+            << ", bc1/bc3: " << (textureCompressionSupported(0x83F0)
+                && textureCompressionSupported(0x83F3))
+            << ", etc2: " << (textureCompressionSupported(0x9274)
+                && textureCompressionSupported(0x9278));
         vts::log(vts::LogLevel::info1, ss.str());
     }
 }
 
+bool textureCompressionSupported(uint32 format)
+{
+    return std::find(compressedTextureFormats.begin(),
+        compressedTextureFormats.end(), format)
+        != compressedTextureFormats.end();
+}
+
 void installGlDebugCallback()
 {
     if (GLAD_GL_KHR_debug && glDebugMessageCallback)
@@ -58,6 +58,11 @@ VTSR_API void loadGlFunctions(GLADloadproc functionLoader);
 // does nothing if the context is not debuggable
 VTSR_API void installGlDebugCallback();
 
+// test whether the compressed texture format (eg. GL_COMPRESSED_RGB8_ETC2)
+//   is supported by the gl context
+// valid after loadGlFunctions
+VTSR_API bool textureCompressionSupported(uint32 format);
+
 } } // namespace vts::renderer
 
 #endif
@@ -124,6 +124,7 @@ struct GeodataJob
 
 extern uint32 maxAntialiasingSamples;
 extern float maxAnisotropySamples;
+extern std::vector<uint32> compressedTextureFormats;
 
 void enableClipDistance(bool enable);
 
@@ -146,6 +146,8 @@ void RenderContext::bindLoadFunctions(Map *map)
         std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
     map->callbacks().loadGeodata = std::bind(&RenderContext::loadGeodata, this,
         std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
+    map->callbacks().textureCompressionSupported
+        = &textureCompressionSupported;
 }
 
 std::shared_ptr<RenderView> RenderContext::createView(Camera *cam)